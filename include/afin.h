@@ -0,0 +1,34 @@
+#ifndef AFIN_H
+#define AFIN_H
+
+// Transformaciones afines del plano en coordenadas de pixel (el pixel
+// (x, y) está en el punto (x, y)). Escalados y rotaciones se expresan
+// como matrices 2x3 y se componen en una sola, de modo que una cadena de
+// operaciones geométricas remuestrea la imagen una única vez.
+
+// (x, y) -> (m[0][0] x + m[0][1] y + m[0][2], m[1][0] x + m[1][1] y + m[1][2])
+struct MatrizAfin {
+    double m[2][3];
+};
+
+MatrizAfin matrizIdentidad();
+// Si 'matriz' no mueve ningún pixel de una imagen de ancho x alto más de
+// una milésima de pixel (la identidad, salvo el redondeo de componer
+// factores float).
+bool esIdentidad(const MatrizAfin& matriz, int ancho, int alto);
+// Escalado de Imagen::escalarImagen por la ruta bilineal directa:
+// x' = factorX * x, y' = factorY * y.
+MatrizAfin matrizEscalado(double factorX, double factorY);
+// Desplazamiento: x' = x + dx, y' = y + dy.
+MatrizAfin matrizTraslacion(double dx, double dy);
+// Rotación de Imagen::rotarImagen: gira 'angulo' grados alrededor del
+// centro de la imagen de ancho x alto y lleva ese centro al de la salida
+// de nuevoAncho x nuevoAlto.
+MatrizAfin matrizRotacion(double angulo, int ancho, int alto, int nuevoAncho, int nuevoAlto);
+
+// Transformación que aplica primero 'antes' y después 'despues'.
+MatrizAfin componerAfin(const MatrizAfin& despues, const MatrizAfin& antes);
+// Inversa de 'matriz'; devuelve false si no es invertible.
+bool invertirAfin(const MatrizAfin& matriz, MatrizAfin& inversa);
+
+#endif
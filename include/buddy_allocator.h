@@ -1,26 +1,262 @@
 #ifndef BUDDY_ALLOCATOR_H
 #define BUDDY_ALLOCATOR_H
 
+#include <atomic>
 #include <cstddef>
+#include <iosfwd>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 class BuddyAllocator {
 public:
+    // De dónde sale la memoria de cada región.
+    enum class Respaldo {
+        Malloc,         // aligned_alloc: la región entera se compromete al crearla
+        Mmap,           // mmap anónimo: las páginas se comprometen al tocarlas y
+                        // los bloques grandes liberados se devuelven al SO
+        MmapHugePages   // Como Mmap, y además los bloques de 2 MB o más se
+                        // marcan con MADV_HUGEPAGE (menos fallos de TLB)
+    };
+
     // Constructor: asigna un bloque de memoria de tamaño especificado.
-    BuddyAllocator(size_t size);
+    // Si 'ampliable' es true, cuando la arena no puede atender una petición
+    // se añade una nueva región en lugar de fallar.
+    BuddyAllocator(size_t size, bool ampliable = true, Respaldo respaldo = Respaldo::Malloc);
 
-    // Destructor: libera el bloque de memoria.
+    // Destructor: libera todas las regiones de memoria.
     ~BuddyAllocator();
 
-    // Asigna un bloque de memoria del tamaño solicitado.
+    BuddyAllocator(const BuddyAllocator&) = delete;
+    BuddyAllocator& operator=(const BuddyAllocator&) = delete;
+
+    // Asigna un bloque de 2^k bytes (el menor que contenga el tamaño
+    // solicitado), dividiendo bloques mayores si hace falta.
+    // Es seguro llamarlo desde varios hilos (p. ej. dentro de regiones OpenMP):
+    // los bloques pequeños salen de una caché propia de cada hilo.
     void* alloc(size_t size);
 
-    // Libera el bloque de memoria (sin efecto en esta implementación).
+    // Devuelve el bloque a su lista libre y lo fusiona con su buddy
+    // mientras éste también esté libre. Seguro desde varios hilos.
     void free(void* ptr);
 
+    // Devuelve al montículo compartido los bloques retenidos en las cachés
+    // de todos los hilos. No debe llamarse mientras otros hilos asignan.
+    void vaciarCaches();
+
+    // Bytes libres en el montículo compartido (sin contar las cachés de hilo).
+    size_t bytesLibres() const;
+
+    // Devuelve toda la arena al estado inicial, invalidando de golpe todos
+    // los bloques asignados (p. ej. al terminar un trabajo). El coste no
+    // depende del número de bloques vivos. Las regiones añadidas al crecer
+    // se conservan. No debe llamarse mientras otros hilos asignan.
+    void reiniciar();
+
+    // Punto de control con ámbito: al destruirse libera los bloques que su
+    // hilo asignó en la arena desde su creación y siguen vivos, salvo los
+    // marcados con conservar(). Así, los temporales de una operación vuelven
+    // a la arena aunque no se liberen uno a uno y sólo sobrevive la salida.
+    // Sólo sigue las asignaciones del hilo que lo crea (las de otros hilos,
+    // p. ej. dentro de una región OpenMP, se liberan como siempre), y los
+    // bloques que sigue deben liberarse desde ese hilo. Se anidan por hilo:
+    // lo conservado pasa al punto de control exterior. Con allocador nulo no
+    // hace nada.
+    class PuntoControl {
+    public:
+        explicit PuntoControl(BuddyAllocator* allocador);
+        ~PuntoControl();
+
+        PuntoControl(const PuntoControl&) = delete;
+        PuntoControl& operator=(const PuntoControl&) = delete;
+
+        // El bloque sobrevive al rebobinado de este punto de control.
+        void conservar(const void* ptr);
+
+    private:
+        friend class BuddyAllocator;
+
+        BuddyAllocator* allocador;
+        PuntoControl* exterior = nullptr;  // Punto de control anterior del mismo hilo
+        std::unordered_set<void*> vivos;   // Asignados por el hilo desde la creación
+        std::unordered_set<const void*> conservados;
+    };
+
+    // Alineación máxima garantizada para los bloques devueltos por alloc().
+    static const size_t ALINEACION_MAXIMA = 4096;
+
+    // Orden mínimo de bloque: 2^6 = 64 bytes (una línea de caché).
+    static const int ORDEN_MINIMO = 6;
+    static const int MAX_ORDENES = 64;
+
+    // Foto de los contadores del allocator. Los bytes se cuentan por
+    // bloque (potencia de dos), no por lo solicitado.
+    struct Estadisticas {
+        size_t tamanoArena = 0;      // Suma de todas las regiones
+        int regiones = 0;
+        size_t bytesEnUso = 0;       // Bloques entregados y no liberados
+        size_t picoBytesEnUso = 0;   // Máximo de bytesEnUso (high-water mark)
+        size_t bytesLibres = 0;      // En las listas libres del montículo
+        size_t bytesEnCaches = 0;    // Retenidos en las cachés de hilo
+        size_t asignaciones = 0;
+        size_t liberaciones = 0;
+        size_t bytesDevueltosSO = 0; // Acumulado de páginas usadas devueltas con MADV_DONTNEED (modos mmap)
+        size_t bloquesLibres[MAX_ORDENES] = {};  // Ocupación de cada lista libre
+        size_t bloqueLibreMayor = 0;
+        // 1 - bloqueLibreMayor / bytesLibres: 0 si todo lo libre es contiguo,
+        // cerca de 1 si está repartido en bloques pequeños.
+        double fragmentacionExterna = 0.0;
+    };
+
+    // Consulta los contadores. Si otros hilos están asignando a la vez, el
+    // reparto entre en uso y cachés es aproximado.
+    Estadisticas estadisticas() const;
+
+    // Imprime las estadísticas en formato legible.
+    void imprimirEstadisticas(std::ostream& salida) const;
+
+private:
+    // Marca de bloque libre en la tabla de estado.
+    static const unsigned char LIBRE = 0x80;
+    // Marca de bloque retenido en la caché de un hilo: consta como asignado
+    // en el montículo, pero un free() sobre él es una doble liberación.
+    static const unsigned char EN_CACHE = 0x40;
+
+    // Nodo de lista doblemente enlazada guardado dentro de cada bloque libre.
+    struct NodoLibre {
+        NodoLibre* anterior;
+        NodoLibre* siguiente;
+    };
+
+    // Los bloques hasta 2^ORDEN_MAXIMO_CACHE bytes se cachean por hilo.
+    static const int ORDEN_MAXIMO_CACHE = 16;
+    // Bytes máximos retenidos por orden en la caché de cada hilo.
+    static const size_t BYTES_CACHE_POR_ORDEN = 256 * 1024;
+    // Bytes que toma una caché vacía del montículo en cada recarga.
+    static const size_t BYTES_LOTE_CACHE = 16 * 1024;
+
+    // Bloques de cada orden retenidos por un hilo. Los bloques cacheados
+    // constan como asignados en el montículo, así que nunca se fusionan.
+    struct CacheHilo {
+        NodoLibre* bloques[ORDEN_MAXIMO_CACHE + 1] = {};
+        size_t cuenta[ORDEN_MAXIMO_CACHE + 1] = {};
+        PuntoControl* puntoControl = nullptr;  // El más interior abierto por el hilo
+    };
+
+    // Número máximo de regiones (la inicial más las añadidas al crecer).
+    static const int MAX_REGIONES = 32;
+
+    // Tramo contiguo de memoria con su propio árbol de buddies. Los bloques
+    // nunca se fusionan entre regiones distintas.
+    struct Region {
+        unsigned char* base = nullptr;
+        size_t tamano = 0;
+        size_t mapeado = 0;   // Bytes de la proyección mmap (0 si es de aligned_alloc)
+        // Un byte por bloque mínimo: 0 si no empieza un bloque ahí; si no,
+        // el orden del bloque, con LIBRE activado cuando está en una lista
+        // libre o EN_CACHE cuando está en la caché de un hilo. Atómico: las
+        // cachés de hilo lo cambian sin el cerrojo mientras freeMonticulo
+        // lee el del buddy con él. LIBRE sólo se pone y se quita con el
+        // cerrojo, así que basta el orden relajado.
+        std::unique_ptr<std::atomic<unsigned char>[]> estado;
+        // Modos mmap: un bit por página, activo si la página no está
+        // comprometida (nunca tocada, o devuelta con MADV_DONTNEED y sin
+        // volver a usarse). Requiere 'cerrojo'.
+        std::vector<bool> paginaDevuelta;
+    };
+
+    static int ordenPara(size_t bytes);
+    static size_t limiteCache(int orden);
+    CacheHilo* cacheLocal();
+    void meterEnCache(CacheHilo& cache, NodoLibre* nodo, int orden);
+    void* tomarBloque(CacheHilo& cache, int orden);
+    void rellenarCache(CacheHilo& cache, int orden);
+    void devolverCache(CacheHilo& cache, int orden, size_t cuantos);
+    void vaciarCache(CacheHilo& cache);
+
+    // Región que contiene 'ptr', o nullptr. No necesita el cerrojo: las
+    // regiones sólo se añaden y se publican con numRegiones.
+    Region* regionDe(const void* ptr);
+    bool ampliar(int orden);
+
+    // Bloques a partir de los cuales se aplican madvise() en los modos mmap.
+    static const int ORDEN_PAGINA_ENORME = 21;    // 2 MB
+    static const int ORDEN_DEVOLVER_SO = 20;      // 1 MB
+
+    bool reservarMemoria(Region& region, size_t tamano);
+    // Marca como comprometidas las páginas de [desplazamiento, desplazamiento + bytes).
+    void usarPaginas(Region& region, size_t desplazamiento, size_t bytes);
+    // Bloque fusionado retirado por freeMonticulo() hasta que se devuelvan al
+    // SO sus páginas comprometidas: tramos [desde, hasta) en bytes.
+    struct Devolucion {
+        Region* region;
+        size_t desplazamiento;
+        int orden;
+        std::vector<std::pair<size_t, size_t>> tramos;
+    };
+    // Marca como devueltas las páginas del tramo aún comprometidas y anota
+    // sus tramos. Requiere 'cerrojo'.
+    void marcarDevueltas(Region& region, size_t desplazamiento, size_t bytes,
+                         std::vector<std::pair<size_t, size_t>>& tramos);
+    // madvise() sin el cerrojo y reinserción de los bloques con él.
+    void completarDevoluciones(std::vector<Devolucion>& devoluciones);
+    void aconsejarPaginasEnormes(void* bloque, int orden);
+
+    // Operaciones sobre el montículo compartido: requieren 'cerrojo'.
+    bool anadirRegion(size_t tamano);
+    void sembrarBloquesRaiz(Region& region);
+    void* allocMonticulo(int orden);
+    // Con 'devoluciones', retira en ella los bloques con páginas que devolver
+    // al SO en lugar de insertarlos (ver completarDevoluciones()).
+    void freeMonticulo(Region& region, size_t desplazamiento, int orden, std::vector<Devolucion>* devoluciones);
+    void insertarLibre(Region& region, size_t desplazamiento, int orden);
+    void quitarLibre(Region& region, size_t desplazamiento, int orden);
+
+    size_t size = 0;     // Tamaño total de la memoria gestionada
+    bool ampliable;
+    Respaldo respaldo;
+    std::atomic<size_t> devueltosSO{0};  // Bytes devueltos con MADV_DONTNEED (cada página, una vez por uso)
+    Region regiones[MAX_REGIONES];
+    std::atomic<int> numRegiones{0};
+    size_t libres = 0;   // Bytes en bloques libres
+    NodoLibre* listasLibres[MAX_ORDENES] = {};  // Una lista por orden
+    size_t cuentaLibres[MAX_ORDENES] = {};      // Longitud de cada lista
+
+    mutable std::mutex cerrojo;  // Protege regiones, listas libres, estado y 'libres'
+    unsigned long id;            // Identifica al allocator en las cachés de hilo
+    std::vector<std::unique_ptr<CacheHilo>> caches;  // Una por hilo que lo ha usado
+
+    // Contadores de uso, actualizados sin cerrojo desde alloc()/free().
+    void registrarAsignacion(int orden);
+    void registrarLiberacion(int orden);
+    std::atomic<size_t> enUso{0};
+    std::atomic<size_t> picoEnUso{0};
+    std::atomic<size_t> asignaciones{0};
+    std::atomic<size_t> liberaciones{0};
+
+    // Cachés del hilo actual: (id del allocator, caché) por cada allocator usado.
+    static thread_local std::vector<std::pair<unsigned long, CacheHilo*>> cachesDelHilo;
+};
+
+// Adaptador std::pmr::memory_resource sobre un BuddyAllocator, para que
+// contenedores std::pmr (vector, string, colas...) usen la misma arena que
+// los pixeles de Imagen. Siguiendo el contrato de memory_resource, lanza
+// std::bad_alloc cuando la arena no puede atender la petición.
+class BuddyResource : public std::pmr::memory_resource {
+public:
+    explicit BuddyResource(BuddyAllocator& allocador) : allocador(allocador) {}
+
+    BuddyAllocator& arena() const { return allocador; }
+
 private:
-    size_t size;         // Tamaño total de la memoria gestionada
-    void* memoriaBase;   // Puntero al bloque de memoria base
-    size_t offset = 0;  
+    void* do_allocate(size_t bytes, size_t alineacion) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alineacion) override;
+    bool do_is_equal(const std::pmr::memory_resource& otro) const noexcept override;
+
+    BuddyAllocator& allocador;
 };
 
-#endif
\ No newline at end of file
+#endif
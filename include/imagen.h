@@ -1,28 +1,241 @@
 #ifndef IMAGEN_H
 #define IMAGEN_H
+#include "afin.h"
 #include "buddy_allocator.h"  
+#include "remuestreo.h"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <vector>
 
 class Imagen {
 public:
+    // Aritmética de la interpolación en escalarImagen / rotarImagen.
+    enum class Precision {
+        Flotante,   // float (escalado) / double (rotación)
+        PuntoFijo   // Pesos enteros Q7: más rápido e idéntico con cualquier número de hilos
+    };
+
+    // Cómo encaja redimensionar la imagen en el tamaño pedido.
+    enum class Ajuste {
+        Estirar,   // Exactamente el tamaño pedido, con un factor por eje
+        Ajustar,   // Cabe entera conservando la proporción: un lado mide lo pedido y el otro no más
+        Llenar     // Cubre el tamaño pedido conservando la proporción; el exceso se recorta centrado
+    };
+
+    // Escalado resuelto para unas dimensiones de entrada: factores por eje
+    // y región [origenX, origenX + nuevoAncho) x [origenY, origenY + nuevoAlto)
+    // de la imagen escalada completa que se calcula (el recorte de
+    // Ajuste::Llenar; sin recorte el origen es 0).
+    struct Escalado {
+        float factorX = 1.0f;
+        float factorY = 1.0f;
+        int nuevoAncho = 0;
+        int nuevoAlto = 0;
+        int origenX = 0;
+        int origenY = 0;
+    };
+
     Imagen(const std::string& rutaArchivo, BuddyAllocator* allocador = nullptr);
     ~Imagen();
 
+    // La imagen es dueña de su buffer de pixeles: no se copia.
+    Imagen(const Imagen&) = delete;
+    Imagen& operator=(const Imagen&) = delete;
+
     bool cargar();
     void mostrarInformacion() const;
 
-    void escalarImagen(float factor); 
-    void rotarImagen(double angulo, unsigned char fillColor = 0); // New method for scaling
+    void establecerPrecision(Precision nuevaPrecision) { precision = nuevaPrecision; }
+    // Dimensiones actuales, sin contar el plan pendiente.
+    int obtenerAncho() const { return ancho; }
+    int obtenerAlto() const { return alto; }
+
+    // Las operaciones geométricas devuelven false si no pudieron aplicarse
+    // (sin memoria, salida sin área).
+    bool escalarImagen(float factor, Filtro filtro = Filtro::Bilineal);
+    // Escalado con un factor distinto en cada eje.
+    bool escalarImagen(float factorX, float factorY, Filtro filtro = Filtro::Bilineal);
+    // Escalado a un tamaño exacto en pixeles según 'ajuste'. Con
+    // Ajuste::Llenar sólo se remuestrea la región que sobrevive al recorte.
+    bool redimensionar(int anchoObjetivo, int altoObjetivo, Ajuste ajuste = Ajuste::Estirar,
+                       Filtro filtro = Filtro::Bilineal);
+    bool rotarImagen(double angulo, unsigned char fillColor = 0); // New method for scaling
+    // Remuestreo bilineal único de una transformación afín arbitraria
+    // (matriz de coordenadas fuente a destino) sobre una salida de
+    // nuevoAncho x nuevoAlto. Lo que cae fuera de la fuente se rellena con
+    // fillColor.
+    bool transformarAfin(const MatrizAfin& matriz, int nuevoAncho, int nuevoAlto, unsigned char fillColor = 0);
+
+    // Guarda la imagen; antes ejecuta el plan diferido pendiente. Devuelve
+    // false si falla el plan o la escritura.
+    bool guardarImagen(const std::string& ruta);
+
+    // --- Plan diferido ---
+    //
+    // planificar* no toca pixeles: anota la operación en un plan que se
+    // optimiza y ejecuta al necesitar los pixeles (materializar, o
+    // guardarImagen / guardarPiramide / cualquier operación inmediata).
+    // El optimizador descarta los pasos nulos, compone la geometría
+    // consecutiva en una sola transformación afín y funde las operaciones
+    // puntuales en la escritura de la salida del remuestreo anterior. La
+    // fusión de tablas da los mismos bytes que aplicarlas una a una; la
+    // composición no: remuestrea una vez en lugar de una por paso, y el
+    // resultado cambia por diseño.
+    void planificarEscalado(float factor, Filtro filtro = Filtro::Bilineal);
+    void planificarEscalado(float factorX, float factorY, Filtro filtro = Filtro::Bilineal);
+    // El tamaño se resuelve con las dimensiones que tenga la imagen al
+    // llegar al paso.
+    void planificarRedimension(int anchoObjetivo, int altoObjetivo, Ajuste ajuste = Ajuste::Estirar,
+                               Filtro filtro = Filtro::Bilineal);
+    void planificarRotacion(double angulo, unsigned char fillColor = 0);
+    // Negativo: v -> 255 - v en cada canal.
+    void planificarInversion();
+    // Ejecuta el plan pendiente; devuelve false si algún paso falla.
+    bool materializar();
+
+    // Pirámide de reducciones sucesivas a la mitad (medias 2x2 exactas),
+    // generada en una sola pasada por bandas de filas: cada nivel se
+    // calcula del anterior mientras éste sigue en caché. Guarda cada nivel
+    // pedido (1 = 1/2, 2 = 1/4, ...) en rutaNivel(rutaSalida, ...). La
+    // imagen no cambia.
+    bool guardarPiramide(const std::vector<int>& niveles, const std::string& rutaSalida);
+    // "salida.png" -> "salida_<ancho>x<alto>.png"
+    static std::string rutaNivel(const std::string& rutaSalida, int ancho, int alto);
+
+    // Dimensiones que producen escalarImagen / rotarImagen sobre una imagen
+    // de ancho x alto, sin tocar pixeles (para dimensionar arenas).
+    static void dimensionesEscalado(int ancho, int alto, float factor, int& nuevoAncho, int& nuevoAlto);
+    static void dimensionesRotacion(int ancho, int alto, double angulo, int& nuevoAncho, int& nuevoAlto);
+    // Escalados que hacen escalarImagen(factorX, factorY) y redimensionar
+    // sobre una imagen de ancho x alto.
+    static Escalado escaladoPorFactores(int ancho, int alto, float factorX, float factorY);
+    static Escalado escaladoPorTamano(int ancho, int alto, int anchoObjetivo, int altoObjetivo, Ajuste ajuste);
 
-    void guardarImagen(const std::string& ruta) const;
+    // Nombre del ajuste en la línea de comandos ("estirar", "ajustar", "llenar").
+    static const char* nombreAjuste(Ajuste ajuste);
+    // Interpreta un nombre de ajuste; devuelve false si no es válido.
+    static bool ajusteDesdeNombre(const std::string& nombre, Ajuste& ajuste);
+
+    // Si escalarImagen usa el remuestreo separable (dos pasadas con una
+    // imagen intermedia de nuevoAncho x alto) o la interpolación bilineal
+    // directa, que sólo es correcta mientras no se reduzca a menos de la mitad.
+    static bool escaladoSeparable(float factor, Filtro filtro);
+    // Igual, para un escalado con un factor por eje: separable si
+    // cualquiera de los dos ejes lo necesita.
+    static bool escaladoSeparable(const Escalado& escalado, Filtro filtro);
+    // Razón n si escalarImagen reduce por medias exactas de bloques n x n
+    // (factor = 1/n con 2 <= n <= MAX_RAZON_CAJA y filtro caja o bilineal),
+    // o 0 si no.
+    static int razonReduccionCaja(float factor, Filtro filtro);
+    // Igual, para un escalado con un factor por eje: sólo si ambos
+    // factores son el mismo 1/n.
+    static int razonReduccionCaja(const Escalado& escalado, Filtro filtro);
+    // Si el escalado es la bilineal directa, que optimizarPlan puede
+    // componer con otras operaciones geométricas: su matriz es
+    // matrizEscalado(factorX, factorY) desplazada al origen del recorte,
+    // pero, a diferencia de transformarAfin, replica la última fila y
+    // columna de la fuente en lugar de rellenar con fillColor.
+    static bool escaladoAfin(const Escalado& escalado, Filtro filtro);
+
+    // Bytes que ocupa un buffer de pixeles reservado por Imagen.
+    static size_t bytesPixeles(int ancho, int alto, int canales);
 
 private:
+    // Quién es dueño del buffer de pixeles y, por tanto, cómo se libera.
+    enum class Origen {
+        Ninguno,   // Sin buffer
+        New,       // new[] alineado (modo convencional)
+        Buddy,     // BuddyAllocator
+        Stb        // Buffer de stbi_load adoptado sin copia (stbi_image_free)
+    };
+
+    // Reserva un buffer contiguo de alto filas de ancho pixeles intercalados,
+    // con filas alineadas; devuelve el paso (bytes por fila) en 'paso'.
+    unsigned char* reservarPixeles(int ancho, int alto, size_t& paso);
+    // Origen de los buffers que entrega reservarPixeles.
+    Origen origenReserva() const { return allocador ? Origen::Buddy : Origen::New; }
+    // Libera un buffer según su origen.
+    static void liberarPixeles(unsigned char* datos, Origen origenDatos, BuddyAllocator* allocador);
+    // Sustituye el buffer actual (liberándolo) por uno nuevo.
+    void reemplazarPixeles(unsigned char* datos, size_t nuevoPaso, Origen origenDatos);
+
+    // Entrada de una etapa de una transformación compuesta que rellena con
+    // fillColor (rotaciones): los pixeles de salida que caen fuera de ella
+    // se rellenan. 'hastaEtapa' lleva coordenadas fuente a las de la etapa.
+    struct ZonaValida {
+        MatrizAfin hastaEtapa;
+        int ancho;
+        int alto;
+    };
+    // Remuestreo bilineal de la transformación cuya inversa (destino a
+    // fuente) es 'inversa', sobre un buffer destino ya reservado. Los
+    // pixeles fuera de alguna de las 'zonas' llevan fillColor; el resto se
+    // interpola replicando la última fila y columna de la fuente.
+    void remuestrearAfin(const MatrizAfin& inversa, const std::vector<ZonaValida>& zonas, unsigned char fillColor,
+                         int nuevoAncho, int nuevoAlto, unsigned char* destino, size_t pasoDestino);
+    // transformarAfin con las zonas de relleno de una cadena compuesta.
+    bool transformarAfin(const MatrizAfin& matriz, const std::vector<ZonaValida>& zonas, int nuevoAncho,
+                         int nuevoAlto, unsigned char fillColor);
+    // Giro exacto de 'cuartos' cuartos de vuelta (0..3), sin interpolar.
+    void girarExacto(int cuartos, int nuevoAncho, int nuevoAlto, unsigned char* destino, size_t pasoDestino);
+    // Ejecuta un escalado ya resuelto (con su recorte) y muestra sus métricas.
+    bool escalarRegion(const Escalado& escalado, Filtro filtro);
+    // Escalado bilineal directo sobre un buffer destino ya reservado.
+    void escalarBilineal(const Escalado& escalado, unsigned char* destino, size_t pasoDestino);
+    // Reducción por medias de bloques razon x razon.
+    void reducirCaja(int razon, const Escalado& escalado, unsigned char* destino, size_t pasoDestino);
+    // Escalado en dos pasadas (horizontal y vertical) con el filtro dado,
+    // sobre un buffer destino ya reservado.
+    void escalarSeparable(const Escalado& escalado, Filtro filtro, unsigned char* destino, size_t pasoDestino);
+
+    // Paso del plan diferido.
+    struct Paso {
+        enum class Tipo {
+            Escalar,         // escalarImagen(escalado.factorX, escalado.factorY, filtro)
+            Redimensionar,   // redimensionar(nuevoAncho, nuevoAlto, ajuste, filtro)
+            Rotar,           // rotarImagen(parametro, fillColor)
+            Afin,            // transformarAfin(matriz, zonas, nuevoAncho, nuevoAlto, fillColor)
+            Tabla            // Operación puntual: v -> tabla[v]
+        };
+        Tipo tipo;
+        double parametro = 0.0;
+        Filtro filtro = Filtro::Bilineal;
+        Escalado escalado = {};   // Escalar: optimizarPlan completa dimensiones y recorte
+        Ajuste ajuste = Ajuste::Estirar;
+        unsigned char fillColor = 0;
+        MatrizAfin matriz = {};
+        std::vector<ZonaValida> zonas;   // Rotar y Afin: etapas que rellenan
+        int nuevoAncho = 0;
+        int nuevoAlto = 0;
+        std::array<unsigned char, 256> tabla = {};
+    };
+    // Plan optimizado a partir de 'plan' (sin ejecutar nada).
+    std::vector<Paso> optimizarPlan() const;
+    // Aplica tablaSalida, si hay, a 'bytes' bytes de salida recién escritos.
+    void aplicarTablaSalida(unsigned char* datos, size_t bytes) const;
+
+    // Recurso para los temporales de las operaciones (tablas, búferes
+    // intermedios): la arena si la imagen usa BuddyAllocator.
+    std::pmr::memory_resource* recursoTemporales() const;
+
+    // Puntero al primer byte de la fila y.
+    unsigned char* fila(int y) const { return pixeles + static_cast<size_t>(y) * paso; }
+
     int ancho;
     int alto;
     int canales;
-    unsigned char*** pixeles;
+    size_t paso;              // Bytes entre el inicio de dos filas consecutivas
+    unsigned char* pixeles;   // pixeles[y * paso + x * canales + c]
+    Origen origen = Origen::Ninguno;
     std::string ruta;
     BuddyAllocator* allocador = nullptr; // <-- guarda el puntero para saber si usar Buddy
+    std::unique_ptr<BuddyResource> recursoBuddy;  // Adaptador pmr de 'allocador'
+    Precision precision = Precision::Flotante;
+    std::vector<Paso> plan;                      // Operaciones pendientes, en orden
+    const unsigned char* tablaSalida = nullptr;  // Tabla fundida en la salida del paso en curso
 };
 
 #endif
@@ -0,0 +1,151 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Núcleos de cómputo por fila usados por Imagen. Operan sobre filas de
+// pixeles intercalados (canal más rápido) y no reservan memoria. Por
+// dentro están especializados para 1 a 4 canales; cada llamada elige la
+// especialización una sola vez.
+
+// --- Nivel de instrucciones ---
+//
+// Los núcleos de escalado, rotación y remuestreo separable se llaman a
+// través de una tabla de punteros que se rellena una vez, en el primer uso,
+// con la mejor implementación que soporta la CPU. Todas producen los mismos
+// bytes. La variable de entorno IPS_SIMD (escalar, sse41, avx2, avx512)
+// fuerza un nivel inferior para probar cada uno.
+enum class NivelSimd {
+    Escalar,   // SSE2 (base de x86-64)
+    SSE41,
+    AVX2,
+    AVX512     // AVX-512F + AVX-512BW
+};
+
+// Nivel elegido para este proceso.
+NivelSimd nivelSimd();
+// Nombre del nivel en IPS_SIMD ("escalar", "sse41", ...).
+const char* nombreNivelSimd(NivelSimd nivel);
+
+// --- Punto fijo (imágenes de 8 bits) ---
+//
+// Pesos Q7 (0..PESO_UNO): la interpolación horizontal cabe en 16 bits
+// (255 * 128) y la vertical en 32, así que ambas etapas se vectorizan con
+// multiplicaciones-suma de enteros de 16 bits (pmaddwd). El resultado sólo
+// depende de los pesos, no del reparto de filas entre hilos.
+constexpr int BITS_PESO = 7;
+constexpr int PESO_UNO = 1 << BITS_PESO;
+
+// Peso en punto fijo de una fracción f en [0, 1], redondeado.
+inline int pesoFijo(double f) {
+    return static_cast<int>(f * PESO_UNO + 0.5);
+}
+
+// Interpolación bilineal en punto fijo de cuatro muestras, redondeada al
+// entero más cercano.
+inline unsigned char bilinealFija(int p11, int p12, int p21, int p22, int wx, int wy) {
+    int arriba = p11 * (PESO_UNO - wx) + p12 * wx;
+    int abajo = p21 * (PESO_UNO - wx) + p22 * wx;
+    int valor = arriba * (PESO_UNO - wy) + abajo * wy;
+    return static_cast<unsigned char>((valor + (1 << (2 * BITS_PESO - 1))) >> (2 * BITS_PESO));
+}
+
+// Vecinos y pesos horizontales de cada pixel de salida de un escalado
+// bilineal. Se calculan una vez por operación y los comparten todos los
+// hilos; los núcleos no dividen ni redondean coordenadas.
+struct TablaHorizontal {
+    const int32_t* desplazamientos1;  // x1 * canales: primer byte del vecino izquierdo
+    const int32_t* desplazamientos2;  // x2 * canales: primer byte del vecino derecho
+    const float* pesos;               // dx, para la ruta en coma flotante
+    const int16_t* pesosFijos;        // dx en Q7, para la ruta en punto fijo
+};
+
+// Escalado bilineal de una fila de salida de 'nuevoAncho' pixeles a partir
+// de las filas fuente y1 (fila1) e y2 (fila2), con peso vertical dy.
+// 'bytesFila' es ancho * canales de la fila fuente. Usa AVX-512 o AVX2
+// según nivelSimd(); el resultado es idéntico bit a bit al de la versión
+// escalar.
+void escalarFilaBilineal(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                         int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, float dy);
+
+// Igual, en punto fijo: usa tabla.pesosFijos y un peso vertical Q7.
+void escalarFilaBilinealFija(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                             int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, int pesoY);
+
+// Versiones concretas, expuestas para poder compararlas entre sí. Las
+// escalares procesan [xInicio, xFin); las AVX2 devuelven el primer pixel
+// que no han escrito.
+void escalarFilaBilinealEscalar(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                const TablaHorizontal& tabla, int xInicio, int xFin, int canales, float dy);
+int escalarFilaBilinealAVX2(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                            int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, float dy);
+void escalarFilaBilinealFijaEscalar(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                    const TablaHorizontal& tabla, int xInicio, int xFin, int canales, int pesoY);
+int escalarFilaBilinealFijaAVX2(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, int pesoY);
+
+// --- Rotación ---
+//
+// Coordenadas fuente en punto fijo Q32.32 sobre int64. A lo largo de una
+// fila de salida avanzan un paso constante (DDA), sin multiplicaciones.
+constexpr int BITS_COORDENADA = 32;
+
+// Pixeles [xInicio, xFin) de una fila de la imagen rotada. El pixel
+// xInicio + i toma la muestra bilineal de la fuente en
+// (origX + i * pasoX, origY + i * pasoY). El llamador garantiza que todas
+// las muestras caen en [0, ancho - 1) x [0, alto - 1), así que el núcleo no
+// comprueba límites.
+void rotarFilaBilineal(const unsigned char* fuente, size_t paso, int canales, unsigned char* destino,
+                       int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX, int64_t pasoY);
+// Igual, con pesos Q7 (Imagen::Precision::PuntoFijo). Desde AVX2 procesa 8
+// pixeles por iteración con gathers; el resultado es idéntico bit a bit al
+// de la versión escalar.
+void rotarFilaBilinealFija(const unsigned char* fuente, size_t paso, int canales, unsigned char* destino,
+                           int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX, int64_t pasoY);
+
+// --- Rotaciones exactas (múltiplos de 90°) ---
+
+// Bloque [nyDesde, nyHasta) x [nxDesde, nxHasta) de la salida de un giro de
+// 90° (cuartos = 1: salida[ny][nx] = fuente[alto - 1 - nx][ny]) o de 270°
+// (cuartos = 3: salida[ny][nx] = fuente[nx][ancho - 1 - ny]). Con 4 canales
+// mueve la mayor parte del bloque en cuadrados de 4x4 pixeles transpuestos
+// con SSE2.
+void girarBloque(const unsigned char* fuente, size_t pasoFuente, int anchoFuente, int altoFuente,
+                 unsigned char* destino, size_t pasoDestino, int canales, int cuartos,
+                 int nyDesde, int nyHasta, int nxDesde, int nxHasta);
+
+// Fila de 'ancho' pixeles en orden inverso (giro de 180°, fila a fila).
+void invertirFila(const unsigned char* fuente, unsigned char* destino, int ancho, int canales);
+
+// --- Operaciones puntuales ---
+
+// datos[i] = tabla[datos[i]] para los 'n' bytes (tabla de 256 entradas).
+void aplicarTabla(unsigned char* datos, size_t n, const unsigned char* tabla);
+
+// --- Remuestreo separable ---
+
+// Pasada horizontal: el pixel de salida x combina los 'taps' pixeles fuente
+// consecutivos desde inicio[x] con los pesos pesos[x * taps ..].
+void remuestrearFilaHorizontal(const unsigned char* fuente, unsigned char* destino, int nuevoAncho, int canales,
+                               const int32_t* inicio, const float* pesos, int taps);
+
+// Pasada vertical: destino[i] = suma de pesos[k] * filas[k][i] para los
+// 'taps' punteros de 'filas'. 'acumulador' tiene al menos 'bytesFila' floats.
+void remuestrearFilaVertical(const unsigned char* const* filas, const float* pesos, int taps,
+                             unsigned char* destino, int bytesFila, float* acumulador);
+
+// --- Reducción por caja de razón entera ---
+
+// Mayor razón que admite reducirFilaCaja: la suma de razón² muestras de
+// 8 bits tiene que caber en 16 bits.
+constexpr int MAX_RAZON_CAJA = 16;
+
+// Pixel de salida = media exacta (redondeada) del bloque razón x razón de
+// la fuente. 'fuente' apunta a la primera de las 'razon' filas del bloque,
+// separadas 'paso' bytes. 'acumulador' tiene al menos nuevoAncho * razon *
+// canales elementos.
+void reducirFilaCaja(const unsigned char* fuente, size_t paso, int razon, unsigned char* destino,
+                     int nuevoAncho, int canales, uint16_t* acumulador);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef REMUESTREO_H
+#define REMUESTREO_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+// Remuestreo separable: un escalado se descompone en una pasada horizontal
+// y otra vertical, cada una con una lista de contribuciones precalculada
+// (qué muestras fuente y con qué peso forman cada muestra de salida). Con
+// un filtro de radio r cada pixel cuesta O(r) por pasada en vez de O(r²).
+
+// Filtros de reconstrucción disponibles.
+enum class Filtro {
+    Caja,       // Vecino más cercano al ampliar; media de área al reducir
+    Bilineal,   // Triángulo, radio 1
+    Bicubico,   // Cúbico de Keys (a = -0.5), radio 2
+    Lanczos     // Lanczos-3, radio 3
+};
+
+// Nombre del filtro en la línea de comandos ("caja", "bilineal", ...).
+const char* nombreFiltro(Filtro filtro);
+// Interpreta un nombre de filtro; devuelve false si no es válido.
+bool filtroDesdeNombre(const std::string& nombre, Filtro& filtro);
+
+// Contribuciones de un eje de 'tamanoFuente' muestras reescalado a
+// 'tamanoDestino'. Todas las muestras de salida tienen 'taps' pesos; la
+// salida i combina las fuentes inicio[i] .. inicio[i] + taps - 1 (siempre
+// dentro de [0, tamanoFuente)) con pesos[i * taps + k], que suman 1. Los
+// pesos que sobran cerca de los bordes valen 0.
+struct Contribuciones {
+    explicit Contribuciones(std::pmr::memory_resource* recurso) : inicio(recurso), pesos(recurso) {}
+
+    int taps = 0;
+    std::pmr::vector<int32_t> inicio;
+    std::pmr::vector<float> pesos;
+};
+
+// Calcula las contribuciones con las muestras alineadas por su centro:
+// la salida i está en (i + 0.5) / factor - 0.5 de la fuente. Al reducir
+// (factor < 1) el soporte del filtro se ensancha en 1 / factor para que
+// actúe como filtro antialiasing. Sólo se calculan las 'tamanoDestino'
+// salidas desde 'primeraSalida' (un recorte del eje escalado completo);
+// la entrada i de la lista es la salida primeraSalida + i.
+void calcularContribuciones(int tamanoFuente, int tamanoDestino, int primeraSalida, float factor, Filtro filtro,
+                            Contribuciones& contribuciones);
+
+#endif
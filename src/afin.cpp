@@ -0,0 +1,75 @@
+/// Archivo: afin.cpp
+/// Construcción, composición e inversión de transformaciones afines
+
+#include "afin.h"
+#include <cmath>
+
+MatrizAfin matrizIdentidad() {
+    return {{{1.0, 0.0, 0.0},
+             {0.0, 1.0, 0.0}}};
+}
+
+bool esIdentidad(const MatrizAfin& matriz, int ancho, int alto) {
+    const double (*m)[3] = matriz.m;
+    // El desplazamiento es afín: basta con mirar las esquinas
+    const double xs[2] = {0.0, static_cast<double>(ancho)};
+    const double ys[2] = {0.0, static_cast<double>(alto)};
+    for (double x : xs) {
+        for (double y : ys) {
+            double dx = m[0][0] * x + m[0][1] * y + m[0][2] - x;
+            double dy = m[1][0] * x + m[1][1] * y + m[1][2] - y;
+            if (std::fabs(dx) > 1e-3 || std::fabs(dy) > 1e-3) return false;
+        }
+    }
+    return true;
+}
+
+MatrizAfin matrizEscalado(double factorX, double factorY) {
+    return {{{factorX, 0.0, 0.0},
+             {0.0, factorY, 0.0}}};
+}
+
+MatrizAfin matrizTraslacion(double dx, double dy) {
+    return {{{1.0, 0.0, dx},
+             {0.0, 1.0, dy}}};
+}
+
+MatrizAfin matrizRotacion(double angulo, int ancho, int alto, int nuevoAncho, int nuevoAlto) {
+    double angleRad = angulo * M_PI / 180.0;
+    double cosTheta = std::cos(angleRad);
+    double sinTheta = std::sin(angleRad);
+    double cx = ancho / 2.0, cy = alto / 2.0;
+    double cxn = nuevoAncho / 2.0, cyn = nuevoAlto / 2.0;
+
+    // (x', y') = R (x - cx, y - cy) + (cx', cy')
+    return {{{cosTheta, -sinTheta, cxn - cosTheta * cx + sinTheta * cy},
+             {sinTheta,  cosTheta, cyn - sinTheta * cx - cosTheta * cy}}};
+}
+
+MatrizAfin componerAfin(const MatrizAfin& despues, const MatrizAfin& antes) {
+    const double (*a)[3] = despues.m;
+    const double (*b)[3] = antes.m;
+    MatrizAfin resultado;
+    for (int i = 0; i < 2; i++) {
+        resultado.m[i][0] = a[i][0] * b[0][0] + a[i][1] * b[1][0];
+        resultado.m[i][1] = a[i][0] * b[0][1] + a[i][1] * b[1][1];
+        resultado.m[i][2] = a[i][0] * b[0][2] + a[i][1] * b[1][2] + a[i][2];
+    }
+    return resultado;
+}
+
+bool invertirAfin(const MatrizAfin& matriz, MatrizAfin& inversa) {
+    const double (*m)[3] = matriz.m;
+    double determinante = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    if (std::fabs(determinante) < 1e-12) return false;
+
+    double a = m[1][1] / determinante, b = -m[0][1] / determinante;
+    double c = -m[1][0] / determinante, d = m[0][0] / determinante;
+    inversa.m[0][0] = a;
+    inversa.m[0][1] = b;
+    inversa.m[0][2] = -(a * m[0][2] + b * m[1][2]);
+    inversa.m[1][0] = c;
+    inversa.m[1][1] = d;
+    inversa.m[1][2] = -(c * m[0][2] + d * m[1][2]);
+    return true;
+}
@@ -1,41 +1,604 @@
 #include "buddy_allocator.h"
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
 
 using namespace std;
 
-// Constructor: asigna un bloque de memoria de tamaño especificado usando malloc.
-BuddyAllocator::BuddyAllocator(size_t size) {
-    this->size = size;
-    memoriaBase = std::malloc(size);
-    if (!memoriaBase) {
+// Alineación de la memoria de cada región: los bloques quedan alineados a
+// su tamaño (hasta una página) respecto a direcciones absolutas.
+static const size_t ALINEACION_BASE = BuddyAllocator::ALINEACION_MAXIMA;
+
+// Tamaño de página del sistema, para los madvise() de los modos mmap.
+static size_t tamanoPagina() {
+    static const size_t pagina = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return pagina;
+}
+
+// Ids únicos: una caché de hilo nunca se confunde con la de un allocator
+// ya destruido que ocupara la misma dirección.
+static std::atomic<unsigned long> siguienteId{1};
+
+thread_local std::vector<std::pair<unsigned long, BuddyAllocator::CacheHilo*>> BuddyAllocator::cachesDelHilo;
+
+// Constructor: reserva la región inicial del tamaño especificado.
+BuddyAllocator::BuddyAllocator(size_t size, bool ampliable, Respaldo respaldo)
+    : ampliable(ampliable), respaldo(respaldo), id(siguienteId++) {
+    if (!anadirRegion(size)) {
         cerr << "Error: No se pudo asignar memoria base con Buddy System.\n";
         exit(1);
     }
 }
 
-// Destructor: libera el bloque de memoria.
+// Destructor: libera todas las regiones.
 BuddyAllocator::~BuddyAllocator() {
-    std::free(memoriaBase);
+    for (int i = 0; i < numRegiones.load(); i++) {
+        if (regiones[i].mapeado) {
+            munmap(regiones[i].base, regiones[i].mapeado);
+        } else {
+            std::free(regiones[i].base);
+        }
+    }
+}
+
+// Obtiene la memoria de una región según el respaldo elegido. Con mmap sólo
+// se reserva espacio de direcciones: el kernel compromete cada página en su
+// primer acceso. En modo páginas enormes la región se alinea a 2 MB para que
+// los bloques grandes puedan respaldarse con páginas de 2 MB.
+bool BuddyAllocator::reservarMemoria(Region& region, size_t tamano) {
+    size_t reservado = (tamano + ALINEACION_BASE - 1) / ALINEACION_BASE * ALINEACION_BASE;
+
+    if (respaldo == Respaldo::Malloc) {
+        void* base = std::aligned_alloc(ALINEACION_BASE, reservado);
+        if (!base) return false;
+        region.base = static_cast<unsigned char*>(base);
+        region.mapeado = 0;
+        return true;
+    }
+
+    size_t alineacion = respaldo == Respaldo::MmapHugePages ? size_t(1) << ORDEN_PAGINA_ENORME : ALINEACION_BASE;
+    size_t mapeado = reservado + alineacion - ALINEACION_BASE;
+    void* mapa = mmap(nullptr, mapeado, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapa == MAP_FAILED) return false;
+
+    // Recortar el exceso antes y después del tramo alineado
+    uintptr_t inicio = reinterpret_cast<uintptr_t>(mapa);
+    uintptr_t alineado = (inicio + alineacion - 1) & ~(uintptr_t(alineacion) - 1);
+    if (alineado > inicio) munmap(mapa, alineado - inicio);
+    size_t sobrante = (inicio + mapeado) - (alineado + reservado);
+    if (sobrante > 0) munmap(reinterpret_cast<void*>(alineado + reservado), sobrante);
+
+    region.base = reinterpret_cast<unsigned char*>(alineado);
+    region.mapeado = reservado;
+    return true;
+}
+
+void BuddyAllocator::usarPaginas(Region& region, size_t desplazamiento, size_t bytes) {
+    if (!region.mapeado) return;
+    size_t pagina = tamanoPagina();
+    for (size_t p = desplazamiento / pagina; p * pagina < desplazamiento + bytes; p++) {
+        region.paginaDevuelta[p] = false;
+    }
+}
+
+// Marca como devueltas las páginas del tramo aún comprometidas y anota sus
+// tramos en 'tramos'; las que ya se devolvieron (p. ej. las de un buddy
+// fusionado) se saltan. El madvise() se hace después, fuera del cerrojo.
+void BuddyAllocator::marcarDevueltas(Region& region, size_t desplazamiento, size_t bytes,
+                                     std::vector<std::pair<size_t, size_t>>& tramos) {
+    size_t pagina = tamanoPagina();
+    size_t primera = desplazamiento / pagina;
+    size_t fin = (desplazamiento + bytes) / pagina;
+    for (size_t p = primera; p < fin;) {
+        if (region.paginaDevuelta[p]) {
+            p++;
+            continue;
+        }
+        size_t q = p;
+        while (q < fin && !region.paginaDevuelta[q]) q++;
+        for (size_t i = p; i < q; i++) region.paginaDevuelta[i] = true;
+        tramos.push_back({p * pagina, q * pagina});
+        p = q;
+    }
+}
+
+// Aplica MADV_DONTNEED a los bloques retirados por freeMonticulo() sin el
+// cerrojo, y después, con él, los devuelve a las listas libres (pueden
+// fusionarse con buddies liberados mientras tanto). Los tramos en los que
+// madvise() falla vuelven a constar como comprometidos.
+void BuddyAllocator::completarDevoluciones(std::vector<Devolucion>& devoluciones) {
+    if (devoluciones.empty()) return;
+    std::vector<std::pair<Region*, std::pair<size_t, size_t>>> fallidos;
+    for (const Devolucion& devolucion : devoluciones) {
+        for (const auto& tramo : devolucion.tramos) {
+            size_t bytes = tramo.second - tramo.first;
+            if (madvise(devolucion.region->base + tramo.first, bytes, MADV_DONTNEED) == 0) {
+                devueltosSO.fetch_add(bytes, std::memory_order_relaxed);
+            } else {
+                fallidos.push_back({devolucion.region, tramo});
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(cerrojo);
+    for (const auto& fallido : fallidos) {
+        usarPaginas(*fallido.first, fallido.second.first, fallido.second.second - fallido.second.first);
+    }
+    for (const Devolucion& devolucion : devoluciones) {
+        freeMonticulo(*devolucion.region, devolucion.desplazamiento, devolucion.orden, nullptr);
+    }
+}
+
+// Añade una región de 'tamano' bytes (redondeado a bloques mínimos) y la
+// reparte en bloques libres. Requiere el cerrojo salvo en el constructor.
+bool BuddyAllocator::anadirRegion(size_t tamano) {
+    int n = numRegiones.load(std::memory_order_relaxed);
+    tamano = tamano >> ORDEN_MINIMO << ORDEN_MINIMO;
+    if (n == MAX_REGIONES || tamano == 0) return false;
+
+    Region& region = regiones[n];
+    if (!reservarMemoria(region, tamano)) return false;
+    region.tamano = tamano;
+    region.estado.reset(new std::atomic<unsigned char>[tamano >> ORDEN_MINIMO]());
+    // Las páginas de mmap no se comprometen hasta tocarlas
+    if (region.mapeado) region.paginaDevuelta.assign((tamano + tamanoPagina() - 1) / tamanoPagina(), true);
+    sembrarBloquesRaiz(region);
+    size += tamano;
+
+    // Publicar la región para las búsquedas sin cerrojo de regionDe()
+    numRegiones.store(n + 1, std::memory_order_release);
+    return true;
+}
+
+// Reparte una región completa en bloques libres. Si su tamaño no es potencia
+// de dos, quedan varios bloques raíz de tamaño decreciente; cada uno está
+// alineado a su propio tamaño.
+void BuddyAllocator::sembrarBloquesRaiz(Region& region) {
+    size_t desplazamiento = 0;
+    for (int orden = MAX_ORDENES - 1; orden >= ORDEN_MINIMO; orden--) {
+        size_t bloque = size_t(1) << orden;
+        if (orden >= 63 || region.tamano - desplazamiento < bloque) continue;
+        insertarLibre(region, desplazamiento, orden);
+        desplazamiento += bloque;
+    }
+}
+
+BuddyAllocator::Region* BuddyAllocator::regionDe(const void* ptr) {
+    const unsigned char* p = static_cast<const unsigned char*>(ptr);
+    int n = numRegiones.load(std::memory_order_acquire);
+    for (int i = 0; i < n; i++) {
+        if (p >= regiones[i].base && p < regiones[i].base + regiones[i].tamano) {
+            return &regiones[i];
+        }
+    }
+    return nullptr;
+}
+
+// Crece la arena con una región capaz de alojar un bloque de 2^orden bytes.
+// Cada región nueva mide al menos la mitad de lo ya gestionado, de modo que
+// el número de regiones crece de forma logarítmica.
+bool BuddyAllocator::ampliar(int orden) {
+    if (!ampliable) return false;
+
+    std::lock_guard<std::mutex> guard(cerrojo);
+    size_t tamano = size_t(1) << orden;
+    if (tamano < size / 2) tamano = size / 2;
+    if (!anadirRegion(tamano)) return false;
+
+    std::cout << "[INFO] BuddyAllocator: arena ampliada en " << tamano / 1024
+              << " KB (total " << size / 1024 << " KB)" << std::endl;
+    return true;
+}
+
+void BuddyAllocator::reiniciar() {
+    std::lock_guard<std::mutex> guard(cerrojo);
+    for (auto& cache : caches) {
+        // Los puntos de control abiertos siguen abiertos, pero sus bloques
+        // ya no existen
+        PuntoControl* puntoControl = cache->puntoControl;
+        for (PuntoControl* p = puntoControl; p; p = p->exterior) p->vivos.clear();
+        *cache = CacheHilo();
+        cache->puntoControl = puntoControl;
+    }
+    for (int orden = 0; orden < MAX_ORDENES; orden++) {
+        listasLibres[orden] = nullptr;
+        cuentaLibres[orden] = 0;
+    }
+    libres = 0;
+    enUso = 0;
+    for (int i = 0; i < numRegiones.load(); i++) {
+        for (size_t b = 0; b < (regiones[i].tamano >> ORDEN_MINIMO); b++) {
+            regiones[i].estado[b].store(0, std::memory_order_relaxed);
+        }
+        sembrarBloquesRaiz(regiones[i]);
+    }
+}
+
+// Menor orden k (>= ORDEN_MINIMO) tal que 2^k >= bytes.
+int BuddyAllocator::ordenPara(size_t bytes) {
+    int orden = ORDEN_MINIMO;
+    while (orden < MAX_ORDENES - 1 && (size_t(1) << orden) < bytes) orden++;
+    return orden;
+}
+
+// Añade el bloque que empieza en 'desplazamiento' a la lista de su orden.
+void BuddyAllocator::insertarLibre(Region& region, size_t desplazamiento, int orden) {
+    NodoLibre* nodo = reinterpret_cast<NodoLibre*>(region.base + desplazamiento);
+    nodo->anterior = nullptr;
+    nodo->siguiente = listasLibres[orden];
+    if (listasLibres[orden]) listasLibres[orden]->anterior = nodo;
+    listasLibres[orden] = nodo;
+
+    region.estado[desplazamiento >> ORDEN_MINIMO].store(static_cast<unsigned char>(orden) | LIBRE,
+                                                        std::memory_order_relaxed);
+    // El nodo compromete la primera página del bloque
+    usarPaginas(region, desplazamiento, sizeof(NodoLibre));
+    libres += size_t(1) << orden;
+    cuentaLibres[orden]++;
+}
+
+// Saca de su lista el bloque libre que empieza en 'desplazamiento'.
+void BuddyAllocator::quitarLibre(Region& region, size_t desplazamiento, int orden) {
+    NodoLibre* nodo = reinterpret_cast<NodoLibre*>(region.base + desplazamiento);
+    if (nodo->anterior) nodo->anterior->siguiente = nodo->siguiente;
+    else listasLibres[orden] = nodo->siguiente;
+    if (nodo->siguiente) nodo->siguiente->anterior = nodo->anterior;
+
+    region.estado[desplazamiento >> ORDEN_MINIMO].store(0, std::memory_order_relaxed);
+    libres -= size_t(1) << orden;
+    cuentaLibres[orden]--;
+}
+
+// Número máximo de bloques de un orden que retiene la caché de un hilo.
+size_t BuddyAllocator::limiteCache(int orden) {
+    size_t limite = BYTES_CACHE_POR_ORDEN >> orden;
+    return limite < 4 ? 4 : limite;
+}
+
+// Caché del hilo actual para este allocator; se crea en el primer uso.
+BuddyAllocator::CacheHilo* BuddyAllocator::cacheLocal() {
+    for (auto& entrada : cachesDelHilo) {
+        if (entrada.first == id) return entrada.second;
+    }
+
+    CacheHilo* cache;
+    {
+        std::lock_guard<std::mutex> guard(cerrojo);
+        caches.push_back(std::make_unique<CacheHilo>());
+        cache = caches.back().get();
+    }
+    cachesDelHilo.emplace_back(id, cache);
+    return cache;
+}
+
+// Añade un bloque asignado a la caché del hilo y lo marca EN_CACHE.
+void BuddyAllocator::meterEnCache(CacheHilo& cache, NodoLibre* nodo, int orden) {
+    Region* region = regionDe(nodo);
+    region->estado[(reinterpret_cast<unsigned char*>(nodo) - region->base) >> ORDEN_MINIMO].store(
+        static_cast<unsigned char>(orden) | EN_CACHE, std::memory_order_relaxed);
+    nodo->siguiente = cache.bloques[orden];
+    cache.bloques[orden] = nodo;
+    cache.cuenta[orden]++;
+}
+
+// Devuelve 'cuantos' bloques de un orden de la caché al montículo.
+void BuddyAllocator::devolverCache(CacheHilo& cache, int orden, size_t cuantos) {
+    std::vector<Devolucion> devoluciones;
+    {
+        std::lock_guard<std::mutex> guard(cerrojo);
+        while (cuantos-- > 0 && cache.bloques[orden]) {
+            NodoLibre* nodo = cache.bloques[orden];
+            cache.bloques[orden] = nodo->siguiente;
+            cache.cuenta[orden]--;
+            Region* region = regionDe(nodo);
+            freeMonticulo(*region, reinterpret_cast<unsigned char*>(nodo) - region->base, orden, &devoluciones);
+        }
+    }
+    completarDevoluciones(devoluciones);
+}
+
+// Devuelve al montículo todos los bloques de una caché.
+void BuddyAllocator::vaciarCache(CacheHilo& cache) {
+    for (int orden = ORDEN_MINIMO; orden <= ORDEN_MAXIMO_CACHE; orden++) {
+        devolverCache(cache, orden, cache.cuenta[orden]);
+    }
+}
+
+void BuddyAllocator::vaciarCaches() {
+    for (auto& cache : caches) {
+        vaciarCache(*cache);
+    }
 }
 
-// Asigna un bloque de memoria del tamaño especificado.
-// Si el tamaño solicitado supera el bloque disponible, devuelve nullptr.
+size_t BuddyAllocator::bytesLibres() const {
+    std::lock_guard<std::mutex> guard(cerrojo);
+    return libres;
+}
+
+// Asigna un bloque del tamaño especificado. Se intenta, por este orden:
+// la caché del hilo (o el montículo, para bloques grandes); lo mismo tras
+// devolver al montículo todo lo que retiene la caché del hilo (puede
+// fusionarse en bloques mayores); y por último una región nueva.
+// Si nada de ello basta, devuelve nullptr.
 void* BuddyAllocator::alloc(size_t bytesSolicitados) {
-    if (offset + bytesSolicitados > size) {
-        std::cerr << "[ERROR] BuddyAllocator sin memoria ("
-                  << bytesSolicitados << " bytes solicitados, "
-                  << size - offset << " bytes disponibles)\n";
-        return nullptr;
+    int orden = ordenPara(bytesSolicitados ? bytesSolicitados : 1);
+    CacheHilo* cache = cacheLocal();
+
+    void* bloque = tomarBloque(*cache, orden);
+    if (!bloque) {
+        vaciarCache(*cache);
+        bloque = tomarBloque(*cache, orden);
+    }
+    if (!bloque && ampliar(orden)) {
+        bloque = tomarBloque(*cache, orden);
     }
 
-    void* ptr = static_cast<unsigned char*>(memoriaBase) + offset;
-    offset += bytesSolicitados;
-    return ptr;
+    if (bloque) {
+        registrarAsignacion(orden);
+        if (cache->puntoControl) cache->puntoControl->vivos.insert(bloque);
+        aconsejarPaginasEnormes(bloque, orden);
+        return bloque;
+    }
+
+    std::cerr << "[ERROR] BuddyAllocator sin memoria ("
+              << bytesSolicitados << " bytes solicitados, "
+              << bytesLibres() << " bytes libres)\n";
+    return nullptr;
+}
+
+// En modo páginas enormes, pide al kernel páginas de 2 MB para los bloques
+// grandes (típicamente buffers de pixeles). Los bloques de 2^k >= 2 MB
+// están alineados a 2 MB porque la región lo está.
+void BuddyAllocator::aconsejarPaginasEnormes(void* bloque, int orden) {
+    if (respaldo != Respaldo::MmapHugePages || orden < ORDEN_PAGINA_ENORME) return;
+    madvise(bloque, size_t(1) << orden, MADV_HUGEPAGE);
+}
+
+// Bloque de 2^orden bytes: de la caché del hilo (rellenándola con un lote
+// del montículo si está vacía) o, para órdenes grandes, del montículo.
+void* BuddyAllocator::tomarBloque(CacheHilo& cache, int orden) {
+    if (orden > ORDEN_MAXIMO_CACHE) {
+        std::lock_guard<std::mutex> guard(cerrojo);
+        return allocMonticulo(orden);
+    }
+
+    if (!cache.bloques[orden]) rellenarCache(cache, orden);
+    NodoLibre* nodo = cache.bloques[orden];
+    if (nodo) {
+        cache.bloques[orden] = nodo->siguiente;
+        cache.cuenta[orden]--;
+        Region* region = regionDe(nodo);
+        region->estado[(reinterpret_cast<unsigned char*>(nodo) - region->base) >> ORDEN_MINIMO].store(
+            static_cast<unsigned char>(orden), std::memory_order_relaxed);
+    }
+    return nodo;
+}
+
+// Rellena la caché con un lote de bloques del orden tomados del montículo.
+void BuddyAllocator::rellenarCache(CacheHilo& cache, int orden) {
+    size_t lote = BYTES_LOTE_CACHE >> orden;
+    if (lote < 1) lote = 1;
+
+    std::lock_guard<std::mutex> guard(cerrojo);
+    for (size_t i = 0; i < lote; i++) {
+        void* bloque = allocMonticulo(orden);
+        if (!bloque) break;
+        meterEnCache(cache, static_cast<NodoLibre*>(bloque), orden);
+    }
 }
 
+// Toma del montículo un bloque de 2^orden bytes, dividiendo uno mayor si
+// hace falta. Devuelve nullptr si no hay ninguno suficientemente grande.
+void* BuddyAllocator::allocMonticulo(int orden) {
+    // Buscar la lista no vacía de menor orden que pueda satisfacer la petición
+    int disponible = orden;
+    while (disponible < MAX_ORDENES && !listasLibres[disponible]) disponible++;
+    if (disponible == MAX_ORDENES) return nullptr;
 
-// Libera el bloque de memoria (sin efecto en esta implementación).
+    Region& region = *regionDe(listasLibres[disponible]);
+    size_t desplazamiento = reinterpret_cast<unsigned char*>(listasLibres[disponible]) - region.base;
+    quitarLibre(region, desplazamiento, disponible);
+
+    // Dividir: la mitad superior (el buddy) vuelve a la lista del orden inferior
+    while (disponible > orden) {
+        disponible--;
+        insertarLibre(region, desplazamiento + (size_t(1) << disponible), disponible);
+    }
+
+    region.estado[desplazamiento >> ORDEN_MINIMO].store(static_cast<unsigned char>(orden), std::memory_order_relaxed);
+    usarPaginas(region, desplazamiento, size_t(1) << orden);
+    return region.base + desplazamiento;
+}
+
+// Libera el bloque. Los órdenes pequeños vuelven a la caché del hilo; si
+// ésta supera su límite, la mitad se devuelve al montículo.
 void BuddyAllocator::free(void* ptr) {
-    // No liberamos porque el Buddy System maneja esto automáticamente.
-}
\ No newline at end of file
+    if (!ptr) return;
+
+    Region* region = regionDe(ptr);
+    size_t desplazamiento = region ? static_cast<unsigned char*>(ptr) - region->base : 0;
+    // El estado de un bloque asignado sólo lo modifica quien lo libera,
+    // así que puede leerse sin el cerrojo.
+    const unsigned char estado =
+        region ? region->estado[desplazamiento >> ORDEN_MINIMO].load(std::memory_order_relaxed) : 0;
+    if (!region ||
+        (desplazamiento & ((size_t(1) << ORDEN_MINIMO) - 1)) != 0 ||
+        estado == 0 || (estado & (LIBRE | EN_CACHE))) {
+        std::cerr << "[ERROR] BuddyAllocator: free() de un puntero no asignado por este allocator\n";
+        return;
+    }
+
+    int orden = estado;
+    registrarLiberacion(orden);
+
+    CacheHilo* cache = cacheLocal();
+    for (PuntoControl* p = cache->puntoControl; p; p = p->exterior) {
+        if (p->vivos.erase(ptr)) break;
+    }
+
+    if (orden <= ORDEN_MAXIMO_CACHE) {
+        meterEnCache(*cache, static_cast<NodoLibre*>(ptr), orden);
+        if (cache->cuenta[orden] > limiteCache(orden)) {
+            devolverCache(*cache, orden, cache->cuenta[orden] / 2);
+        }
+        return;
+    }
+
+    std::vector<Devolucion> devoluciones;
+    {
+        std::lock_guard<std::mutex> guard(cerrojo);
+        freeMonticulo(*region, desplazamiento, orden, &devoluciones);
+    }
+    completarDevoluciones(devoluciones);
+}
+
+// Devuelve un bloque asignado al montículo y lo fusiona con su buddy
+// mientras éste esté libre y tenga el mismo orden.
+void BuddyAllocator::freeMonticulo(Region& region, size_t desplazamiento, int orden,
+                                   std::vector<Devolucion>* devoluciones) {
+    region.estado[desplazamiento >> ORDEN_MINIMO].store(0, std::memory_order_relaxed);
+
+    while (orden < MAX_ORDENES - 1) {
+        size_t buddy = desplazamiento ^ (size_t(1) << orden);
+        if (buddy + (size_t(1) << orden) > region.tamano ||
+            region.estado[buddy >> ORDEN_MINIMO].load(std::memory_order_relaxed) !=
+                (static_cast<unsigned char>(orden) | LIBRE)) {
+            break;
+        }
+        quitarLibre(region, buddy, orden);
+        desplazamiento &= ~(size_t(1) << orden);
+        orden++;
+    }
+
+    // Devolver al SO las páginas comprometidas del bloque fusionado, salvo la
+    // primera, que guarda el nodo de la lista libre. Volverán a comprometerse
+    // (a cero) si el bloque se reutiliza. Si queda alguna, el bloque se retira
+    // hasta que completarDevoluciones() haga el madvise() sin el cerrojo: no
+    // está en ninguna lista y su estado es 0, así que nadie lo toma ni se
+    // fusiona con él.
+    if (devoluciones && region.mapeado && orden >= ORDEN_DEVOLVER_SO) {
+        size_t pagina = tamanoPagina();
+        Devolucion devolucion = {&region, desplazamiento, orden, {}};
+        marcarDevueltas(region, desplazamiento + pagina, (size_t(1) << orden) - pagina, devolucion.tramos);
+        if (!devolucion.tramos.empty()) {
+            devoluciones->push_back(std::move(devolucion));
+            return;
+        }
+    }
+
+    insertarLibre(region, desplazamiento, orden);
+}
+
+// Los bloques de 2^k bytes están alineados a min(2^k, ALINEACION_MAXIMA):
+// basta con pedir al menos 'alineacion' bytes.
+void* BuddyResource::do_allocate(size_t bytes, size_t alineacion) {
+    if (alineacion > BuddyAllocator::ALINEACION_MAXIMA) {
+        throw std::bad_alloc();
+    }
+    void* ptr = allocador.alloc(bytes < alineacion ? alineacion : bytes);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void BuddyResource::do_deallocate(void* ptr, size_t, size_t) {
+    allocador.free(ptr);
+}
+
+bool BuddyResource::do_is_equal(const std::pmr::memory_resource& otro) const noexcept {
+    const BuddyResource* buddy = dynamic_cast<const BuddyResource*>(&otro);
+    return buddy && &buddy->allocador == &allocador;
+}
+
+BuddyAllocator::PuntoControl::PuntoControl(BuddyAllocator* allocador) : allocador(allocador) {
+    if (!allocador) return;
+    CacheHilo* cache = allocador->cacheLocal();
+    exterior = cache->puntoControl;
+    cache->puntoControl = this;
+}
+
+// Libera los bloques vivos no conservados. Los conservados pasan al punto de
+// control exterior, que los liberará salvo que también los conserve.
+BuddyAllocator::PuntoControl::~PuntoControl() {
+    if (!allocador) return;
+    allocador->cacheLocal()->puntoControl = exterior;
+    for (void* ptr : vivos) {
+        if (!conservados.count(ptr)) {
+            allocador->free(ptr);
+        } else if (exterior) {
+            exterior->vivos.insert(ptr);
+        }
+    }
+}
+
+void BuddyAllocator::PuntoControl::conservar(const void* ptr) {
+    conservados.insert(ptr);
+}
+
+void BuddyAllocator::registrarAsignacion(int orden) {
+    size_t actual = enUso.fetch_add(size_t(1) << orden, std::memory_order_relaxed) + (size_t(1) << orden);
+    size_t pico = picoEnUso.load(std::memory_order_relaxed);
+    while (actual > pico && !picoEnUso.compare_exchange_weak(pico, actual, std::memory_order_relaxed)) {
+    }
+    asignaciones.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BuddyAllocator::registrarLiberacion(int orden) {
+    enUso.fetch_sub(size_t(1) << orden, std::memory_order_relaxed);
+    liberaciones.fetch_add(1, std::memory_order_relaxed);
+}
+
+BuddyAllocator::Estadisticas BuddyAllocator::estadisticas() const {
+    Estadisticas e;
+    e.regiones = numRegiones.load(std::memory_order_acquire);
+    e.asignaciones = asignaciones.load(std::memory_order_relaxed);
+    e.liberaciones = liberaciones.load(std::memory_order_relaxed);
+    e.picoBytesEnUso = picoEnUso.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> guard(cerrojo);
+    e.tamanoArena = size;
+    e.bytesEnUso = enUso.load(std::memory_order_relaxed);
+    e.bytesLibres = libres;
+    e.bytesDevueltosSO = devueltosSO.load(std::memory_order_relaxed);
+    for (int orden = 0; orden < MAX_ORDENES; orden++) {
+        e.bloquesLibres[orden] = cuentaLibres[orden];
+        if (cuentaLibres[orden]) e.bloqueLibreMayor = size_t(1) << orden;
+    }
+    // Todo byte de la arena está libre, en uso o retenido en una caché
+    size_t ocupados = e.bytesLibres + e.bytesEnUso;
+    e.bytesEnCaches = e.tamanoArena > ocupados ? e.tamanoArena - ocupados : 0;
+    if (e.bytesLibres > 0) {
+        e.fragmentacionExterna = 1.0 - static_cast<double>(e.bloqueLibreMayor) / e.bytesLibres;
+    }
+    return e;
+}
+
+void BuddyAllocator::imprimirEstadisticas(std::ostream& salida) const {
+    Estadisticas e = estadisticas();
+    salida << "[INFO] Estadísticas del Buddy System:\n";
+    salida << "  Tamaño de la arena: " << e.tamanoArena / 1024.0 << " KB en " << e.regiones << " región(es)\n";
+    salida << "  En uso: " << e.bytesEnUso / 1024.0 << " KB (pico: " << e.picoBytesEnUso / 1024.0 << " KB)\n";
+    salida << "  Libres: " << e.bytesLibres / 1024.0 << " KB (en cachés de hilo: " << e.bytesEnCaches / 1024.0 << " KB)\n";
+    salida << "  Asignaciones: " << e.asignaciones << ", liberaciones: " << e.liberaciones << "\n";
+    if (respaldo != Respaldo::Malloc) {
+        salida << "  Devuelto al sistema (MADV_DONTNEED): " << e.bytesDevueltosSO / 1024.0 << " KB\n";
+    }
+    salida << "  Mayor bloque libre: " << e.bloqueLibreMayor / 1024.0 << " KB\n";
+    salida << "  Fragmentación externa: " << std::fixed << std::setprecision(1)
+           << e.fragmentacionExterna * 100.0 << " %" << std::defaultfloat << std::setprecision(6) << "\n";
+    salida << "  Bloques libres por orden:";
+    for (int orden = ORDEN_MINIMO; orden < MAX_ORDENES; orden++) {
+        if (e.bloquesLibres[orden]) {
+            salida << " 2^" << orden << "x" << e.bloquesLibres[orden];
+        }
+    }
+    salida << "\n";
+}
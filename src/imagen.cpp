@@ -2,102 +2,216 @@
 /// Implementación de la clase Imagen con soporte para Buddy System
 
 #include "imagen.h"
+#include "kernels.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <sys/resource.h>
 #include <malloc.h>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
 #include <omp.h>
 
 
 using namespace std;
 using namespace std::chrono;
 
+// Alineación de las filas del buffer de pixeles (una línea de caché).
+static const size_t ALINEACION_FILA = 64;
+
+// Lado (en pixeles) de los bloques de salida de la rotación.
+static const int BLOQUE_ROTACION = 64;
+
 // Constructor
 Imagen::Imagen(const std::string& rutaArchivo, BuddyAllocator* allocador)
-    : ancho(0), alto(0), canales(0), pixeles(nullptr), ruta(rutaArchivo), allocador(allocador) {}
+    : ancho(0), alto(0), canales(0), paso(0), pixeles(nullptr), ruta(rutaArchivo), allocador(allocador) {
+    if (allocador) {
+        recursoBuddy = std::make_unique<BuddyResource>(*allocador);
+    }
+}
 
 // Destructor
 Imagen::~Imagen() {
-    // Solo liberar si usamos new/delete (el Buddy System no libera manualmente)
-    if (!allocador && pixeles) {
-        for (int y = 0; y < alto; y++) {
-            for (int x = 0; x < ancho; x++) {
-                delete[] pixeles[y][x];
-            }
-            delete[] pixeles[y];
+    liberarPixeles(pixeles, origen, allocador);
+}
+
+// Paso de fila: ancho * canales redondeado a ALINEACION_FILA.
+static size_t pasoPara(int ancho, int canales) {
+    size_t bytesFila = static_cast<size_t>(ancho) * canales;
+    return (bytesFila + ALINEACION_FILA - 1) / ALINEACION_FILA * ALINEACION_FILA;
+}
+
+size_t Imagen::bytesPixeles(int ancho, int alto, int canales) {
+    return pasoPara(ancho, canales) * static_cast<size_t>(alto);
+}
+
+void Imagen::dimensionesEscalado(int ancho, int alto, float factor, int& nuevoAncho, int& nuevoAlto) {
+    nuevoAncho = static_cast<int>(ancho * factor);
+    nuevoAlto = static_cast<int>(alto * factor);
+}
+
+Imagen::Escalado Imagen::escaladoPorFactores(int ancho, int alto, float factorX, float factorY) {
+    Escalado escalado;
+    escalado.factorX = factorX;
+    escalado.factorY = factorY;
+    escalado.nuevoAncho = static_cast<int>(ancho * factorX);
+    escalado.nuevoAlto = static_cast<int>(alto * factorY);
+    return escalado;
+}
+
+// Los factores salen de las dimensiones enteras de la imagen escalada
+// completa, así que cada eje se estira exactamente de borde a borde.
+Imagen::Escalado Imagen::escaladoPorTamano(int ancho, int alto, int anchoObjetivo, int altoObjetivo, Ajuste ajuste) {
+    int anchoTotal = anchoObjetivo;
+    int altoTotal = altoObjetivo;
+    if (ajuste != Ajuste::Estirar) {
+        // Un solo factor: el del eje que limita (Ajustar) o el que cubre
+        // (Llenar); el otro eje se redondea con él
+        const double razonX = static_cast<double>(anchoObjetivo) / ancho;
+        const double razonY = static_cast<double>(altoObjetivo) / alto;
+        const bool mandaAncho = (ajuste == Ajuste::Ajustar) ? razonX <= razonY : razonX >= razonY;
+        if (mandaAncho) {
+            altoTotal = std::max(1, static_cast<int>(std::lround(alto * razonX)));
+        } else {
+            anchoTotal = std::max(1, static_cast<int>(std::lround(ancho * razonY)));
         }
-        delete[] pixeles;
     }
+
+    Escalado escalado;
+    escalado.factorX = static_cast<float>(anchoTotal) / ancho;
+    escalado.factorY = static_cast<float>(altoTotal) / alto;
+    // Con Llenar sobra imagen en un eje: se calcula sólo el centro
+    escalado.nuevoAncho = std::min(anchoTotal, anchoObjetivo);
+    escalado.nuevoAlto = std::min(altoTotal, altoObjetivo);
+    escalado.origenX = (anchoTotal - escalado.nuevoAncho) / 2;
+    escalado.origenY = (altoTotal - escalado.nuevoAlto) / 2;
+    return escalado;
 }
 
-// Cargar imagen desde archivo y convertir a matriz tridimensional
-bool Imagen::cargar() {
-    unsigned char* datos = stbi_load(ruta.c_str(), &ancho, &alto, &canales, 0);
-    if (!datos) {
-        cerr << "Error al cargar la imagen: " << ruta << endl;
-        return false;
+const char* Imagen::nombreAjuste(Ajuste ajuste) {
+    switch (ajuste) {
+        case Ajuste::Estirar: return "estirar";
+        case Ajuste::Ajustar: return "ajustar";
+        case Ajuste::Llenar:  return "llenar";
     }
+    return "?";
+}
 
-    cout << "[OK] Imagen cargada desde: " << ruta << endl;
+bool Imagen::ajusteDesdeNombre(const std::string& nombre, Ajuste& ajuste) {
+    for (Ajuste candidato : {Ajuste::Estirar, Ajuste::Ajustar, Ajuste::Llenar}) {
+        if (nombre == nombreAjuste(candidato)) {
+            ajuste = candidato;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Cuartos de vuelta (0..3) si el ángulo es múltiplo de 90°, o -1.
+static int cuartosDeVuelta(double angulo) {
+    double cuartos = angulo / 90.0;
+    double redondeado = std::round(cuartos);
+    if (std::fabs(cuartos - redondeado) > 1e-9) return -1;
+    int resto = static_cast<int>(std::fmod(redondeado, 4.0));
+    return resto < 0 ? resto + 4 : resto;
+}
+
+// Bounding box de la imagen rotada.
+void Imagen::dimensionesRotacion(int ancho, int alto, double angulo, int& nuevoAncho, int& nuevoAlto) {
+    // Múltiplos de 90°: dimensiones exactas, sin el redondeo de cos/sin
+    int cuartos = cuartosDeVuelta(angulo);
+    if (cuartos >= 0) {
+        nuevoAncho = (cuartos % 2) ? alto : ancho;
+        nuevoAlto = (cuartos % 2) ? ancho : alto;
+        return;
+    }
+
+    double angleRad = angulo * M_PI / 180.0;
+    double absCos = std::fabs(cos(angleRad));
+    double absSin = std::fabs(sin(angleRad));
+    // Nota: ancho y alto son int, se usan double en intermedios
+    double w = static_cast<double>(ancho);
+    double h = static_cast<double>(alto);
+
+    nuevoAncho = static_cast<int>(std::ceil(w * absCos + h * absSin));
+    nuevoAlto  = static_cast<int>(std::ceil(w * absSin + h * absCos));
+}
+
+// Reserva un único bloque contiguo para toda la imagen. Cada fila ocupa
+// 'paso' bytes (ancho * canales redondeado a ALINEACION_FILA).
+unsigned char* Imagen::reservarPixeles(int anchoBuffer, int altoBuffer, size_t& pasoBuffer) {
+    pasoBuffer = pasoPara(anchoBuffer, canales);
+    size_t total = bytesPixeles(anchoBuffer, altoBuffer, canales);
 
-    // Reservar espacio para pixeles[alto]
+    unsigned char* datos = nullptr;
     if (allocador) {
-        pixeles = reinterpret_cast<unsigned char***>(
-            allocador->alloc(alto * sizeof(unsigned char**))
-        );
-        if (!pixeles) {
+        datos = static_cast<unsigned char*>(allocador->alloc(total));
+        if (!datos) {
             cerr << "Error: No se pudo asignar memoria con BuddyAllocator para pixeles." << endl;
-            stbi_image_free(datos);
-            return false;
         }
     } else {
-        pixeles = new unsigned char**[alto];
+        // nothrow: el fallo llega al llamador como nullptr, igual que con Buddy
+        datos = new (std::align_val_t(ALINEACION_FILA), std::nothrow) unsigned char[total];
+        if (!datos) {
+            cerr << "Error: No se pudo asignar memoria para pixeles." << endl;
+        }
     }
+    return datos;
+}
 
-    int indice = 0;
+std::pmr::memory_resource* Imagen::recursoTemporales() const {
+    if (recursoBuddy) return recursoBuddy.get();
+    return std::pmr::new_delete_resource();
+}
 
-    for (int y = 0; y < alto; y++) {
-        // pixeles[y] ← ancho
-        if (allocador) {
-            pixeles[y] = reinterpret_cast<unsigned char**>(
-                allocador->alloc(ancho * sizeof(unsigned char*))
-            );
-            if (!pixeles[y]) {
-                cerr << "Error: Falla al asignar fila " << y << " con BuddyAllocator." << endl;
-                stbi_image_free(datos);
-                return false;
-            }
-        } else {
-            pixeles[y] = new unsigned char*[ancho];
-        }
+// Libera un buffer según quién lo haya reservado.
+void Imagen::liberarPixeles(unsigned char* datos, Origen origenDatos, BuddyAllocator* allocador) {
+    if (!datos) return;
+    switch (origenDatos) {
+        case Origen::New:
+            ::operator delete[](datos, std::align_val_t(ALINEACION_FILA));
+            break;
+        case Origen::Buddy:
+            allocador->free(datos);
+            break;
+        case Origen::Stb:
+            stbi_image_free(datos);
+            break;
+        case Origen::Ninguno:
+            break;
+    }
+}
 
-        for (int x = 0; x < ancho; x++) {
-            // pixeles[y][x] ← canales
-            if (allocador) {
-                pixeles[y][x] = reinterpret_cast<unsigned char*>(
-                    allocador->alloc(canales * sizeof(unsigned char))
-                );
-                if (!pixeles[y][x]) {
-                    cerr << "Error: Falla al asignar columna " << x << " con BuddyAllocator." << endl;
-                    stbi_image_free(datos);
-                    return false;
-                }
-            } else {
-                pixeles[y][x] = new unsigned char[canales];
-            }
+// Libera el buffer actual y adopta 'datos' como nuevo buffer de pixeles.
+void Imagen::reemplazarPixeles(unsigned char* datos, size_t nuevoPaso, Origen origenDatos) {
+    liberarPixeles(pixeles, origen, allocador);
+    pixeles = datos;
+    paso = nuevoPaso;
+    origen = origenDatos;
+}
 
-            // Copiar los valores RGB (o RGBA)
-            for (int c = 0; c < canales; c++) {
-                pixeles[y][x][c] = datos[indice++];
-            }
-        }
+// Cargar imagen desde archivo. El buffer decodificado por stbi_load
+// (filas empaquetadas) se adopta tal cual como buffer de pixeles, sin copia;
+// se libera con stbi_image_free cuando se reemplaza o se destruye la imagen.
+bool Imagen::cargar() {
+    int nuevoAncho, nuevoAlto, nuevosCanales;
+    unsigned char* datos = stbi_load(ruta.c_str(), &nuevoAncho, &nuevoAlto, &nuevosCanales, 0);
+    if (!datos) {
+        cerr << "Error al cargar la imagen: " << ruta << endl;
+        return false;
     }
 
-    stbi_image_free(datos);
+    cout << "[OK] Imagen cargada desde: " << ruta << endl;
+
+    ancho = nuevoAncho;
+    alto = nuevoAlto;
+    canales = nuevosCanales;
+    reemplazarPixeles(datos, static_cast<size_t>(ancho) * canales, Origen::Stb);
     return true;
 }
 
@@ -107,84 +221,218 @@ void Imagen::mostrarInformacion() const {
     cout << "Canales: " << canales << endl;
 }
 
-void Imagen::escalarImagen(float factor) {
-    auto inicio = high_resolution_clock::now();
-    struct rusage usage_before, usage_after;
-    getrusage(RUSAGE_SELF, &usage_before);
-    struct mallinfo2 mem_before = mallinfo2();
-
-    int nuevoAncho = static_cast<int>(ancho * factor);
-    int nuevoAlto = static_cast<int>(alto * factor);
-    
-    // Crear nueva matriz para la imagen escalada
-    unsigned char*** nuevosPixeles;
-    if (allocador) {
-        nuevosPixeles = reinterpret_cast<unsigned char***>(
-            allocador->alloc(nuevoAlto * sizeof(unsigned char**))
-        );
-    } else {
-        nuevosPixeles = new unsigned char**[nuevoAlto];
+int Imagen::razonReduccionCaja(float factor, Filtro filtro) {
+    if (filtro != Filtro::Caja && filtro != Filtro::Bilineal) return 0;
+    if (factor <= 0.0f || factor > 0.5f) return 0;
+    // Admite la representación float de 1/n (0.1f no es exactamente 1/10)
+    int razon = static_cast<int>(std::lround(1.0 / factor));
+    if (razon < 2 || razon > MAX_RAZON_CAJA || std::fabs(razon * static_cast<double>(factor) - 1.0) > 1e-6) {
+        return 0;
     }
+    return razon;
+}
 
-    // Asignar memoria para las filas y columnas
-    for (int y = 0; y < nuevoAlto; y++) {
-        if (allocador) {
-            nuevosPixeles[y] = reinterpret_cast<unsigned char**>(
-                allocador->alloc(nuevoAncho * sizeof(unsigned char*))
-            );
-        } else {
-            nuevosPixeles[y] = new unsigned char*[nuevoAncho];
-        }
+bool Imagen::escaladoSeparable(float factor, Filtro filtro) {
+    if (razonReduccionCaja(factor, filtro)) return false;
+    // Con factor >= 0.5 el soporte del triángulo abarca a lo sumo los dos
+    // vecinos que ya combina la bilineal directa
+    return filtro != Filtro::Bilineal || factor < 0.5f;
+}
 
-        for (int x = 0; x < nuevoAncho; x++) {
-            if (allocador) {
-                nuevosPixeles[y][x] = reinterpret_cast<unsigned char*>(
-                    allocador->alloc(canales * sizeof(unsigned char))
-                );
-            } else {
-                nuevosPixeles[y][x] = new unsigned char[canales];
-            }
+int Imagen::razonReduccionCaja(const Escalado& escalado, Filtro filtro) {
+    if (escalado.factorX != escalado.factorY) return 0;
+    return razonReduccionCaja(escalado.factorX, filtro);
+}
+
+bool Imagen::escaladoSeparable(const Escalado& escalado, Filtro filtro) {
+    if (razonReduccionCaja(escalado, filtro)) return false;
+    return escaladoSeparable(escalado.factorX, filtro) || escaladoSeparable(escalado.factorY, filtro);
+}
+
+bool Imagen::escaladoAfin(const Escalado& escalado, Filtro filtro) {
+    return filtro == Filtro::Bilineal && !razonReduccionCaja(escalado, filtro) && !escaladoSeparable(escalado, filtro);
+}
+
+// Cada pixel de salida es la media de un bloque razon x razon completo de
+// la fuente; las filas y columnas que no llenan un bloque se descartan.
+void Imagen::reducirCaja(int razon, const Escalado& escalado, unsigned char* destino, size_t pasoDestino) {
+    std::pmr::memory_resource* recurso = recursoTemporales();
+    const int nuevoAncho = escalado.nuevoAncho;
+    const int nuevoAlto = escalado.nuevoAlto;
+    const size_t elementos = static_cast<size_t>(nuevoAncho) * razon * canales;
+    const size_t desplazamiento = static_cast<size_t>(escalado.origenX) * razon * canales;
+
+    #pragma omp parallel
+    {
+        std::pmr::vector<uint16_t> acumulador(elementos, recurso);
+
+        #pragma omp for
+        for (int y = 0; y < nuevoAlto; y++) {
+            unsigned char* filaDestino = destino + static_cast<size_t>(y) * pasoDestino;
+            reducirFilaCaja(fila((escalado.origenY + y) * razon) + desplazamiento, paso, razon, filaDestino,
+                            nuevoAncho, canales, acumulador.data());
+            aplicarTablaSalida(filaDestino, static_cast<size_t>(nuevoAncho) * canales);
         }
     }
+}
+
+// Interpolación bilineal directa: cada pixel de salida combina los cuatro
+// vecinos de ((origenX + x) / factorX, (origenY + y) / factorY).
+void Imagen::escalarBilineal(const Escalado& escalado, unsigned char* destino, size_t pasoDestino) {
+    const int nuevoAncho = escalado.nuevoAncho;
+    const int nuevoAlto = escalado.nuevoAlto;
+    // Vecinos y pesos de cada columna y de cada fila de salida: se calculan
+    // una vez y los comparten todos los hilos
+    std::pmr::memory_resource* recurso = recursoTemporales();
+    std::pmr::vector<int32_t> desplazamientos1(nuevoAncho, recurso);
+    std::pmr::vector<int32_t> desplazamientos2(nuevoAncho, recurso);
+    std::pmr::vector<float> pesosX(nuevoAncho, recurso);
+    std::pmr::vector<int16_t> pesosFijosX(nuevoAncho, recurso);
+    for (int x = 0; x < nuevoAncho; x++) {
+        float origX = (escalado.origenX + x) / escalado.factorX;
+        int x1 = static_cast<int>(origX);
+        desplazamientos1[x] = x1 * canales;
+        desplazamientos2[x] = std::min(x1 + 1, ancho - 1) * canales;
+        pesosX[x] = origX - x1;
+        pesosFijosX[x] = static_cast<int16_t>(pesoFijo(pesosX[x]));
+    }
+    const TablaHorizontal tabla = {
+        desplazamientos1.data(), desplazamientos2.data(), pesosX.data(), pesosFijosX.data()
+    };
+
+    std::pmr::vector<int32_t> filas1(nuevoAlto, recurso);
+    std::pmr::vector<int32_t> filas2(nuevoAlto, recurso);
+    std::pmr::vector<float> pesosY(nuevoAlto, recurso);
+    for (int y = 0; y < nuevoAlto; y++) {
+        float origY = (escalado.origenY + y) / escalado.factorY;
+        filas1[y] = static_cast<int>(origY);
+        filas2[y] = std::min(filas1[y] + 1, alto - 1);
+        pesosY[y] = origY - filas1[y];
+    }
 
-    // Realizar el escalado usando interpolación bilineal
+    // Realizar el escalado usando interpolación bilineal, fila a fila
+    const bool puntoFijo = (precision == Precision::PuntoFijo);
+    const int bytesFila = ancho * canales;
     #pragma omp parallel for
     for (int y = 0; y < nuevoAlto; y++) {
-        for (int x = 0; x < nuevoAncho; x++) {
-            float origX = x / factor;
-            float origY = y / factor;
-            
-            int x1 = static_cast<int>(origX);
-            int y1 = static_cast<int>(origY);
-            int x2 = std::min(x1 + 1, ancho - 1);
-            int y2 = std::min(y1 + 1, alto - 1);
-            
-            float dx = origX - x1;
-            float dy = origY - y1;
-
-            for (int c = 0; c < canales; c++) {
-                float valor = 
-                    pixeles[y1][x1][c] * (1 - dx) * (1 - dy) +
-                    pixeles[y1][x2][c] * dx * (1 - dy) +
-                    pixeles[y2][x1][c] * (1 - dx) * dy +
-                    pixeles[y2][x2][c] * dx * dy;
-                
-                nuevosPixeles[y][x][c] = static_cast<unsigned char>(valor);
-            }
+        unsigned char* filaDestino = destino + static_cast<size_t>(y) * pasoDestino;
+        if (puntoFijo) {
+            escalarFilaBilinealFija(fila(filas1[y]), fila(filas2[y]), filaDestino, bytesFila, tabla,
+                                    nuevoAncho, canales, pesoFijo(pesosY[y]));
+        } else {
+            escalarFilaBilineal(fila(filas1[y]), fila(filas2[y]), filaDestino, bytesFila, tabla,
+                                nuevoAncho, canales, pesosY[y]);
         }
+        aplicarTablaSalida(filaDestino, static_cast<size_t>(nuevoAncho) * canales);
     }
+}
+
+// Remuestreo separable: la pasada horizontal lleva las filas fuente que usa
+// la salida a nuevoAncho pixeles en una imagen intermedia; la vertical
+// combina, para cada fila de salida, 'taps' filas intermedias. Con recorte,
+// ninguna de las dos pasadas calcula pixeles que se descartan.
+void Imagen::escalarSeparable(const Escalado& escalado, Filtro filtro, unsigned char* destino, size_t pasoDestino) {
+    const int nuevoAncho = escalado.nuevoAncho;
+    const int nuevoAlto = escalado.nuevoAlto;
+    std::pmr::memory_resource* recurso = recursoTemporales();
+    Contribuciones horizontales(recurso);
+    Contribuciones verticales(recurso);
+    calcularContribuciones(ancho, nuevoAncho, escalado.origenX, escalado.factorX, filtro, horizontales);
+    calcularContribuciones(alto, nuevoAlto, escalado.origenY, escalado.factorY, filtro, verticales);
+
+    // Filas fuente [primeraFila, ultimaFila) que alcanza la pasada vertical
+    const int taps = verticales.taps;
+    const int primeraFila = *std::min_element(verticales.inicio.begin(), verticales.inicio.end());
+    const int ultimaFila = *std::max_element(verticales.inicio.begin(), verticales.inicio.end()) + taps;
 
-    if (!allocador) {
-        for (int y = 0; y < alto; y++) {
-            for (int x = 0; x < ancho; x++) {
-                delete[] pixeles[y][x];
+    const size_t pasoIntermedio = pasoPara(nuevoAncho, canales);
+    std::pmr::vector<unsigned char> intermedia(pasoIntermedio * (ultimaFila - primeraFila), recurso);
+
+    #pragma omp parallel for
+    for (int y = primeraFila; y < ultimaFila; y++) {
+        remuestrearFilaHorizontal(fila(y), intermedia.data() + static_cast<size_t>(y - primeraFila) * pasoIntermedio,
+                                  nuevoAncho, canales, horizontales.inicio.data(),
+                                  horizontales.pesos.data(), horizontales.taps);
+    }
+
+    const int bytesFila = nuevoAncho * canales;
+    #pragma omp parallel
+    {
+        std::pmr::vector<float> acumulador(bytesFila, recurso);
+        std::pmr::vector<const unsigned char*> filas(taps, recurso);
+
+        #pragma omp for
+        for (int y = 0; y < nuevoAlto; y++) {
+            for (int k = 0; k < taps; k++) {
+                filas[k] = intermedia.data() +
+                           static_cast<size_t>(verticales.inicio[y] + k - primeraFila) * pasoIntermedio;
             }
-            delete[] pixeles[y];
+            unsigned char* filaDestino = destino + static_cast<size_t>(y) * pasoDestino;
+            remuestrearFilaVertical(filas.data(), &verticales.pesos[static_cast<size_t>(y) * taps], taps,
+                                    filaDestino, bytesFila, acumulador.data());
+            aplicarTablaSalida(filaDestino, bytesFila);
         }
-        delete[] pixeles;
+    }
+}
+
+bool Imagen::escalarImagen(float factor, Filtro filtro) {
+    return escalarImagen(factor, factor, filtro);
+}
+
+bool Imagen::escalarImagen(float factorX, float factorY, Filtro filtro) {
+    if (!materializar()) return false;
+    return escalarRegion(escaladoPorFactores(ancho, alto, factorX, factorY), filtro);
+}
+
+bool Imagen::redimensionar(int anchoObjetivo, int altoObjetivo, Ajuste ajuste, Filtro filtro) {
+    if (!materializar()) return false;
+    return escalarRegion(escaladoPorTamano(ancho, alto, anchoObjetivo, altoObjetivo, ajuste), filtro);
+}
+
+bool Imagen::escalarRegion(const Escalado& escalado, Filtro filtro) {
+    auto inicio = high_resolution_clock::now();
+    struct rusage usage_before, usage_after;
+    getrusage(RUSAGE_SELF, &usage_before);
+    struct mallinfo2 mem_before = mallinfo2();
+    size_t buddy_before = allocador ? allocador->estadisticas().bytesEnUso : 0;
+
+    const int nuevoAncho = escalado.nuevoAncho;
+    const int nuevoAlto = escalado.nuevoAlto;
+    if (nuevoAncho <= 0 || nuevoAlto <= 0) {
+        cerr << "Error: El escalado deja la imagen sin área." << endl;
+        return false;
+    }
+
+    // Punto de control: al salir, todo lo asignado en la arena durante el
+    // escalado vuelve a ella salvo el buffer de salida
+    BuddyAllocator::PuntoControl puntoControl(allocador);
+
+    // Crear nuevo buffer para la imagen escalada
+    size_t nuevoPaso;
+    unsigned char* nuevosPixeles = reservarPixeles(nuevoAncho, nuevoAlto, nuevoPaso);
+    if (!nuevosPixeles) {
+        cerr << "Error: No se pudo asignar memoria para el escalado." << endl;
+        return false;
+    }
+    puntoControl.conservar(nuevosPixeles);
+
+    int razon = razonReduccionCaja(escalado, filtro);
+    bool separable = !razon && escaladoSeparable(escalado, filtro);
+    // Los bloques tienen que caber en la fuente; si el redondeo de las
+    // dimensiones lo impide, el motor separable hace la misma reducción
+    if (razon && ((escalado.origenX + nuevoAncho) * razon > ancho || (escalado.origenY + nuevoAlto) * razon > alto)) {
+        razon = 0;
+        separable = true;
+    }
+    if (razon) {
+        reducirCaja(razon, escalado, nuevosPixeles, nuevoPaso);
+    } else if (separable) {
+        escalarSeparable(escalado, filtro, nuevosPixeles, nuevoPaso);
+    } else {
+        escalarBilineal(escalado, nuevosPixeles, nuevoPaso);
     }
 
-    pixeles = nuevosPixeles;
+    reemplazarPixeles(nuevosPixeles, nuevoPaso, origenReserva());
     ancho = nuevoAncho;
     alto = nuevoAlto;
 
@@ -193,146 +441,274 @@ void Imagen::escalarImagen(float factor) {
     struct mallinfo2 mem_after = mallinfo2();
 
     auto duracion = duration_cast<milliseconds>(fin - inicio).count();
-    cout << "\n[INFO] Escalado de imagen (factor " << factor << "):" << endl;
+    cout << "\n[INFO] Escalado de imagen (factor " << escalado.factorX;
+    if (escalado.factorY != escalado.factorX) cout << " x " << escalado.factorY;
+    if (escalado.origenX || escalado.origenY) {
+        cout << ", recorte desde (" << escalado.origenX << ", " << escalado.origenY << ")";
+    }
+    cout << ", filtro " << nombreFiltro(filtro)
+         << (razon ? ", medias por bloques" : "")
+         << (separable ? ", dos pasadas" : "")
+         << (!separable && precision == Precision::PuntoFijo ? ", punto fijo" : "") << "):" << endl;
     cout << "  Tiempo de procesamiento: " << duracion << " ms" << endl;
-    cout << "  Memoria utilizada: " << (mem_after.uordblks - mem_before.uordblks) / 1024.0 << " KB" << endl;
+    if (allocador) {
+        BuddyAllocator::Estadisticas buddy_after = allocador->estadisticas();
+        cout << "  Memoria utilizada (Buddy): "
+             << (static_cast<double>(buddy_after.bytesEnUso) - static_cast<double>(buddy_before)) / 1024.0
+             << " KB (pico de la arena: " << buddy_after.picoBytesEnUso / 1024.0 << " KB)" << endl;
+    } else {
+        cout << "  Memoria utilizada: " << (mem_after.uordblks - mem_before.uordblks) / 1024.0 << " KB" << endl;
+    }
     cout << "  CPU User: " << (usage_after.ru_utime.tv_sec - usage_before.ru_utime.tv_sec) * 1000.0 +
             (usage_after.ru_utime.tv_usec - usage_before.ru_utime.tv_usec) / 1000.0 << " ms" << endl;
     cout << "  CPU System: " << (usage_after.ru_stime.tv_sec - usage_before.ru_stime.tv_sec) * 1000.0 +
             (usage_after.ru_stime.tv_usec - usage_before.ru_stime.tv_usec) / 1000.0 << " ms" << endl;
     cout << "  Nuevas dimensiones: " << ancho << "x" << alto << endl;
+    return true;
 }
 
-void Imagen::rotarImagen(double angulo, unsigned char fillColor /*= 0*/) {
-    using namespace std;
-    using namespace std::chrono;
+// División entera redondeando hacia -infinito (divisor > 0).
+static int64_t divisionPorDefecto(int64_t a, int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
 
-    auto inicio = high_resolution_clock::now();
-    struct rusage usage_before, usage_after;
-    getrusage(RUSAGE_SELF, &usage_before);
-    struct mallinfo2 mem_before = mallinfo2();
+// Tramo [desde, hasta) de x en [0, n) con 0 <= origen + x * paso < limite.
+// Todo es entero (Q32.32), así que el tramo coincide exactamente con los
+// pixeles que el núcleo va a visitar.
+static void tramoDentro(int64_t origen, int64_t paso, int64_t limite, int n, int& desde, int& hasta) {
+    int64_t d, h;
+    if (paso > 0) {
+        d = -divisionPorDefecto(origen, paso);                 // ceil(-origen / paso)
+        h = divisionPorDefecto(limite - origen - 1, paso) + 1;
+    } else if (paso < 0) {
+        d = divisionPorDefecto(origen - limite, -paso) + 1;
+        h = divisionPorDefecto(origen, -paso) + 1;
+    } else {
+        bool dentro = origen >= 0 && origen < limite;
+        d = 0;
+        h = dentro ? n : 0;
+    }
+    desde = static_cast<int>(std::clamp<int64_t>(d, 0, n));
+    hasta = static_cast<int>(std::clamp<int64_t>(h, 0, n));
+}
 
-    // Convertir ángulo a radianes
-    double angleRad = angulo * M_PI / 180.0;
-    double cosTheta = cos(angleRad);
-    double sinTheta = sin(angleRad);
+// Tramo [desde, hasta) de la fila ny cuya posición por 'matriz' (destino a
+// la entrada de una etapa, en Q32.32 como el núcleo) cae en [0, ancho - 1) x
+// [0, alto - 1), recortado al tramo que se pasa.
+static void recortarTramo(const MatrizAfin& matriz, int ancho, int alto, int ny, int nuevoAncho,
+                          int& desde, int& hasta) {
+    const double (*m)[3] = matriz.m;
+    const double uno = static_cast<double>(int64_t(1) << BITS_COORDENADA);
+    int desdeX, hastaX, desdeY, hastaY;
+    tramoDentro(std::llround((m[0][1] * ny + m[0][2]) * uno), std::llround(m[0][0] * uno),
+                static_cast<int64_t>(ancho - 1) << BITS_COORDENADA, nuevoAncho, desdeX, hastaX);
+    tramoDentro(std::llround((m[1][1] * ny + m[1][2]) * uno), std::llround(m[1][0] * uno),
+                static_cast<int64_t>(alto - 1) << BITS_COORDENADA, nuevoAncho, desdeY, hastaY);
+    desde = std::max({desde, desdeX, desdeY});
+    hasta = std::max(desde, std::min({hasta, hastaX, hastaY}));
+}
 
-    // 1) Calcular bounding box
-    // Nota: ancho y alto son int, se usan double en intermedios
-    double w = static_cast<double>(ancho);
-    double h = static_cast<double>(alto);
+// Pixel de salida cuya posición fuente (Q32.32) cae en la última fila o
+// columna, o más allá: bilineal con los vecinos limitados a la fuente, como
+// escalarBilineal.
+static void muestrearBorde(const unsigned char* fuente, size_t paso, int ancho, int alto, int canales,
+                           int64_t origX, int64_t origY, bool puntoFijo, unsigned char* destino) {
+    const double uno = static_cast<double>(int64_t(1) << BITS_COORDENADA);
+    const double x = std::clamp(origX / uno, 0.0, static_cast<double>(ancho - 1));
+    const double y = std::clamp(origY / uno, 0.0, static_cast<double>(alto - 1));
+    const int x1 = static_cast<int>(x);
+    const int y1 = static_cast<int>(y);
+    const int x2 = std::min(x1 + 1, ancho - 1);
+    const int y2 = std::min(y1 + 1, alto - 1);
+    const double fx = x - x1;
+    const double fy = y - y1;
+    const unsigned char* fila1 = fuente + static_cast<size_t>(y1) * paso;
+    const unsigned char* fila2 = fuente + static_cast<size_t>(y2) * paso;
+    for (int c = 0; c < canales; c++) {
+        const int p11 = fila1[x1 * canales + c], p12 = fila1[x2 * canales + c];
+        const int p21 = fila2[x1 * canales + c], p22 = fila2[x2 * canales + c];
+        if (puntoFijo) {
+            destino[c] = bilinealFija(p11, p12, p21, p22, pesoFijo(fx), pesoFijo(fy));
+        } else {
+            double interp = (1 - fx) * (1 - fy) * p11 + fx * (1 - fy) * p12 + (1 - fx) * fy * p21 + fx * fy * p22;
+            destino[c] = static_cast<unsigned char>(std::round(interp));
+        }
+    }
+}
 
-    double absCos = std::fabs(cosTheta);
-    double absSin = std::fabs(sinTheta);
+// Interpolación bilineal de la transformada inversa, por bloques de la
+// salida (rotaciones y cadenas geométricas compuestas).
+void Imagen::remuestrearAfin(const MatrizAfin& inversa, const std::vector<ZonaValida>& zonas,
+                             unsigned char fillColor, int nuevoAncho, int nuevoAlto,
+                             unsigned char* destinoBase, size_t pasoDestino) {
+    const double (*m)[3] = inversa.m;
 
-    int nuevoAncho = static_cast<int>(std::ceil(w * absCos + h * absSin));
-    int nuevoAlto  = static_cast<int>(std::ceil(w * absSin + h * absCos));
+    // La transformada inversa de cada fila es lineal en nx, así que basta
+    // la coordenada fuente del primer pixel y el paso entre pixeles (Q32.32)
+    const double uno = static_cast<double>(int64_t(1) << BITS_COORDENADA);
+    const int64_t pasoX = std::llround(m[0][0] * uno);
+    const int64_t pasoY = std::llround(m[1][0] * uno);
+    const bool puntoFijo = (precision == Precision::PuntoFijo);
 
-    // 2) Crear nueva matriz con el bounding box
-    unsigned char*** nuevosPixeles;
-    if (allocador) {
-        nuevosPixeles = reinterpret_cast<unsigned char***>(
-            allocador->alloc(nuevoAlto * sizeof(unsigned char**))
-        );
-        if (!nuevosPixeles) {
-            cerr << "Error: No se pudo asignar memoria con BuddyAllocator para rotación." << endl;
-            return;
+    // Destino a la entrada de cada etapa que rellena
+    std::vector<MatrizAfin> hastaZonas;
+    for (const ZonaValida& zona : zonas) hastaZonas.push_back(componerAfin(zona.hastaEtapa, inversa));
+
+    // Origen de cada fila y dos tramos, una vez por fila: el válido (dentro
+    // de todas las zonas; fuera va fillColor) y, dentro de él, el interior,
+    // que el núcleo interpola sin salirse de la fuente. Lo que queda entre
+    // ambos (última fila o columna) se interpola replicando el borde. Los
+    // bloques de abajo sólo recortan los tramos a sus columnas.
+    std::pmr::vector<int64_t> origenesX(nuevoAlto, recursoTemporales());
+    std::pmr::vector<int64_t> origenesY(nuevoAlto, recursoTemporales());
+    std::pmr::vector<int32_t> desdes(nuevoAlto, recursoTemporales());
+    std::pmr::vector<int32_t> hastas(nuevoAlto, recursoTemporales());
+    std::pmr::vector<int32_t> desdesInterior(nuevoAlto, recursoTemporales());
+    std::pmr::vector<int32_t> hastasInterior(nuevoAlto, recursoTemporales());
+    #pragma omp parallel for
+    for (int ny = 0; ny < nuevoAlto; ny++) {
+        // coordenadas fuente de nx = 0
+        origenesX[ny] = std::llround((m[0][1] * ny + m[0][2]) * uno);
+        origenesY[ny] = std::llround((m[1][1] * ny + m[1][2]) * uno);
+
+        int desde = 0, hasta = nuevoAncho;
+        for (size_t z = 0; z < zonas.size(); z++) {
+            recortarTramo(hastaZonas[z], zonas[z].ancho, zonas[z].alto, ny, nuevoAncho, desde, hasta);
         }
-        for (int y = 0; y < nuevoAlto; y++) {
-            nuevosPixeles[y] = reinterpret_cast<unsigned char**>(
-                allocador->alloc(nuevoAncho * sizeof(unsigned char*))
-            );
-            for (int x = 0; x < nuevoAncho; x++) {
-                nuevosPixeles[y][x] = reinterpret_cast<unsigned char*>(
-                    allocador->alloc(canales * sizeof(unsigned char))
-                );
-                // Inicializar con fillColor
-                for (int c = 0; c < canales; c++) {
-                    nuevosPixeles[y][x][c] = fillColor;
+        desdes[ny] = desde;
+        hastas[ny] = hasta;
+        recortarTramo(inversa, ancho, alto, ny, nuevoAncho, desde, hasta);
+        desdesInterior[ny] = desde;
+        hastasInterior[ny] = hasta;
+    }
+
+    // La salida se recorre en bloques de BLOQUE_ROTACION x BLOQUE_ROTACION:
+    // una fila de salida cruza la fuente en diagonal, pero un bloque lee
+    // una región compacta que se reutiliza en caché de una fila a la
+    // siguiente. Los bloques son también la unidad de trabajo de los hilos.
+    const int bloquesY = (nuevoAlto + BLOQUE_ROTACION - 1) / BLOQUE_ROTACION;
+    const int bloquesX = (nuevoAncho + BLOQUE_ROTACION - 1) / BLOQUE_ROTACION;
+    #pragma omp parallel for collapse(2) schedule(dynamic)
+    for (int by = 0; by < bloquesY; by++) {
+        for (int bx = 0; bx < bloquesX; bx++) {
+            const int nx0 = bx * BLOQUE_ROTACION;
+            const int nx1 = std::min(nx0 + BLOQUE_ROTACION, nuevoAncho);
+            const int nyFin = std::min((by + 1) * BLOQUE_ROTACION, nuevoAlto);
+            for (int ny = by * BLOQUE_ROTACION; ny < nyFin; ny++) {
+                unsigned char* destino = destinoBase + static_cast<size_t>(ny) * pasoDestino;
+                int desde = std::clamp(static_cast<int>(desdes[ny]), nx0, nx1);
+                int hasta = std::clamp(static_cast<int>(hastas[ny]), desde, nx1);
+                int desdeInterior = std::clamp(static_cast<int>(desdesInterior[ny]), desde, hasta);
+                int hastaInterior = std::clamp(static_cast<int>(hastasInterior[ny]), desdeInterior, hasta);
+
+                // Sólo las esquinas fuera del tramo llevan fillColor; el
+                // tramo se escribe una única vez
+                memset(destino + static_cast<size_t>(nx0) * canales, fillColor,
+                       static_cast<size_t>(desde - nx0) * canales);
+                memset(destino + static_cast<size_t>(hasta) * canales, fillColor,
+                       static_cast<size_t>(nx1 - hasta) * canales);
+
+                for (int nx = desde; nx < hasta; nx++) {
+                    if (nx == desdeInterior) nx = hastaInterior;
+                    if (nx >= hasta) break;
+                    muestrearBorde(pixeles, paso, ancho, alto, canales, origenesX[ny] + nx * pasoX,
+                                   origenesY[ny] + nx * pasoY, puntoFijo, destino + static_cast<size_t>(nx) * canales);
+                }
+                if (desdeInterior < hastaInterior) {
+                    int64_t origX = origenesX[ny] + desdeInterior * pasoX;
+                    int64_t origY = origenesY[ny] + desdeInterior * pasoY;
+                    if (puntoFijo) {
+                        rotarFilaBilinealFija(pixeles, paso, canales, destino, desdeInterior, hastaInterior,
+                                              origX, origY, pasoX, pasoY);
+                    } else {
+                        rotarFilaBilineal(pixeles, paso, canales, destino, desdeInterior, hastaInterior,
+                                          origX, origY, pasoX, pasoY);
+                    }
                 }
+                aplicarTablaSalida(destino + static_cast<size_t>(nx0) * canales, static_cast<size_t>(nx1 - nx0) * canales);
             }
         }
-    } else {
-        nuevosPixeles = new unsigned char**[nuevoAlto];
+    }
+}
+
+// Giros de 90°, 180° y 270° sin interpolar: cada pixel de salida es una
+// copia de un pixel fuente.
+void Imagen::girarExacto(int cuartos, int nuevoAncho, int nuevoAlto, unsigned char* destino, size_t pasoDestino) {
+    const size_t bytesFila = static_cast<size_t>(nuevoAncho) * canales;
+    if (cuartos == 0) {
+        #pragma omp parallel for
+        for (int y = 0; y < nuevoAlto; y++) {
+            memcpy(destino + static_cast<size_t>(y) * pasoDestino, fila(y), bytesFila);
+            aplicarTablaSalida(destino + static_cast<size_t>(y) * pasoDestino, bytesFila);
+        }
+    } else if (cuartos == 2) {
+        #pragma omp parallel for
         for (int y = 0; y < nuevoAlto; y++) {
-            nuevosPixeles[y] = new unsigned char*[nuevoAncho];
-            for (int x = 0; x < nuevoAncho; x++) {
-                nuevosPixeles[y][x] = new unsigned char[canales];
-                for (int c = 0; c < canales; c++) {
-                    nuevosPixeles[y][x][c] = fillColor;
+            invertirFila(fila(alto - 1 - y), destino + static_cast<size_t>(y) * pasoDestino, ancho, canales);
+            aplicarTablaSalida(destino + static_cast<size_t>(y) * pasoDestino, bytesFila);
+        }
+    } else {
+        // Transposición por bloques: un bloque de salida lee otro igual de
+        // la fuente, y ambos caben en L1/L2
+        const int bloquesY = (nuevoAlto + BLOQUE_ROTACION - 1) / BLOQUE_ROTACION;
+        const int bloquesX = (nuevoAncho + BLOQUE_ROTACION - 1) / BLOQUE_ROTACION;
+        #pragma omp parallel for collapse(2) schedule(dynamic)
+        for (int by = 0; by < bloquesY; by++) {
+            for (int bx = 0; bx < bloquesX; bx++) {
+                int ny = by * BLOQUE_ROTACION;
+                int nx = bx * BLOQUE_ROTACION;
+                int nyFin = std::min(ny + BLOQUE_ROTACION, nuevoAlto);
+                int nxFin = std::min(nx + BLOQUE_ROTACION, nuevoAncho);
+                girarBloque(pixeles, paso, ancho, alto, destino, pasoDestino, canales, cuartos, ny, nyFin, nx, nxFin);
+                for (int y = ny; y < nyFin; y++) {
+                    aplicarTablaSalida(destino + static_cast<size_t>(y) * pasoDestino + static_cast<size_t>(nx) * canales,
+                                       static_cast<size_t>(nxFin - nx) * canales);
                 }
             }
         }
     }
+}
 
-    // 3) Centros: original (cx, cy), nuevo (cx', cy')
-    // Ojo: ancho, alto son enteros
-    double cx = w / 2.0;      // centro original
-    double cy = h / 2.0;
-    double cxn = nuevoAncho / 2.0; // centro nueva
-    double cyn = nuevoAlto  / 2.0;
+bool Imagen::rotarImagen(double angulo, unsigned char fillColor /*= 0*/) {
+    using namespace std;
+    using namespace std::chrono;
 
-    // 4) Para cada pixel (x, y) del nuevo lienzo, hallar (origX, origY)
-    #pragma omp parallel for
-    for (int ny = 0; ny < nuevoAlto; ny++) {
-        for (int nx = 0; nx < nuevoAncho; nx++) {
-            // coordenadas relativas al centro del nuevo lienzo
-            double dx = nx - cxn;
-            double dy = ny - cyn;
-
-            // transformada inversa
-            double origX =  cosTheta * dx + sinTheta * dy + cx;
-            double origY = -sinTheta * dx + cosTheta * dy + cy;
-
-            // Bilinear o nearest neighbor:
-            // Verificamos si cae dentro de la imagen original
-            if (origX >= 0.0 && origX < (w - 1) &&
-                origY >= 0.0 && origY < (h - 1)) 
-            {
-                // Bilinear
-                int x1 = static_cast<int>(floor(origX));
-                int y1 = static_cast<int>(floor(origY));
-                int x2 = x1 + 1;
-                int y2 = y1 + 1;
-                if (x2>=w) x2=w-1;
-                if (y2>=h) y2=h-1;
-
-                double fx = origX - x1;
-                double fy = origY - y1;
-                double fx1 = 1.0 - fx;
-                double fy1 = 1.0 - fy;
-
-                for (int c = 0; c < canales; c++) {
-                    double p00 = pixeles[y1][x1][c];
-                    double p10 = pixeles[y1][x2][c];
-                    double p01 = pixeles[y2][x1][c];
-                    double p11 = pixeles[y2][x2][c];
-
-                    double interp = (fx1 * fy1 * p00) + (fx * fy1 * p10) +
-                    (fx1 * fy * p01) + (fx * fy * p11);
-
-                    nuevosPixeles[ny][nx][c] = static_cast<unsigned char>(std::round(interp));
-                }
-            }
-            // else: se queda fillColor
-        }
+    if (!materializar()) return false;
+
+    auto inicio = high_resolution_clock::now();
+    struct rusage usage_before, usage_after;
+    getrusage(RUSAGE_SELF, &usage_before);
+    struct mallinfo2 mem_before = mallinfo2();
+    size_t buddy_before = allocador ? allocador->estadisticas().bytesEnUso : 0;
+
+    // 1) Calcular bounding box
+    int nuevoAncho, nuevoAlto;
+    dimensionesRotacion(ancho, alto, angulo, nuevoAncho, nuevoAlto);
+
+    // 2) Crear nuevo buffer con el bounding box (cada fila rellena con
+    // fillColor lo que queda fuera de la imagen rotada, ver 4).
+    // Como en el escalado, sólo la salida sobrevive al punto de control.
+    BuddyAllocator::PuntoControl puntoControl(allocador);
+    size_t nuevoPaso;
+    unsigned char* nuevosPixeles = reservarPixeles(nuevoAncho, nuevoAlto, nuevoPaso);
+    if (!nuevosPixeles) {
+        cerr << "Error: No se pudo asignar memoria para la rotación." << endl;
+        return false;
     }
+    puntoControl.conservar(nuevosPixeles);
 
-    // Liberar la imagen original si NO es Buddy
-    if (!allocador) {
-        if (pixeles) {
-            for (int y = 0; y < alto; y++) {
-                for (int x = 0; x < ancho; x++) {
-                    delete[] pixeles[y][x];
-                }
-                delete[] pixeles[y];
-            }
-            delete[] pixeles;
-        }
+    const int cuartos = cuartosDeVuelta(angulo);
+    if (cuartos >= 0) {
+        girarExacto(cuartos, nuevoAncho, nuevoAlto, nuevosPixeles, nuevoPaso);
+    } else {
+        MatrizAfin inversa;
+        invertirAfin(matrizRotacion(angulo, ancho, alto, nuevoAncho, nuevoAlto), inversa);
+        remuestrearAfin(inversa, {{matrizIdentidad(), ancho, alto}}, fillColor, nuevoAncho, nuevoAlto,
+                        nuevosPixeles, nuevoPaso);
     }
 
-    // Actualizar puntero y dimensiones
-    pixeles = nuevosPixeles;
+    // Liberar la imagen original y actualizar puntero y dimensiones
+    reemplazarPixeles(nuevosPixeles, nuevoPaso, origenReserva());
     ancho   = nuevoAncho;
     alto    = nuevoAlto;
 
@@ -342,31 +718,416 @@ void Imagen::rotarImagen(double angulo, unsigned char fillColor /*= 0*/) {
     struct mallinfo2 mem_after = mallinfo2();
     auto duracion = duration_cast<milliseconds>(fin - inicio).count();
 
-    cout << "\n[INFO] Rotación de imagen (ángulo " << angulo << " grados):" << endl;
+    cout << "\n[INFO] Rotación de imagen (ángulo " << angulo << " grados"
+         << (cuartos >= 0 ? ", exacta" : precision == Precision::PuntoFijo ? ", punto fijo" : "") << "):" << endl;
+    cout << "  Tiempo de procesamiento: " << duracion << " ms" << endl;
+    if (allocador) {
+        BuddyAllocator::Estadisticas buddy_after = allocador->estadisticas();
+        cout << "  Memoria utilizada (Buddy): "
+             << (static_cast<double>(buddy_after.bytesEnUso) - static_cast<double>(buddy_before)) / 1024.0
+             << " KB (pico de la arena: " << buddy_after.picoBytesEnUso / 1024.0 << " KB)" << endl;
+    } else {
+        cout << "  Memoria utilizada: " << (mem_after.uordblks - mem_before.uordblks) / 1024.0 << " KB" << endl;
+    }
+    cout << "  CPU User: " << (usage_after.ru_utime.tv_sec - usage_before.ru_utime.tv_sec) * 1000.0 +
+            (usage_after.ru_utime.tv_usec - usage_before.ru_utime.tv_usec) / 1000.0 << " ms" << endl;
+    cout << "  CPU System: " << (usage_after.ru_stime.tv_sec - usage_before.ru_stime.tv_sec) * 1000.0 +
+            (usage_after.ru_stime.tv_usec - usage_before.ru_stime.tv_usec) / 1000.0 << " ms" << endl;
+    cout << "  Nuevas dimensiones: " << ancho << " x " << alto << endl;
+    return true;
+}
+
+bool Imagen::transformarAfin(const MatrizAfin& matriz, int nuevoAncho, int nuevoAlto, unsigned char fillColor /*= 0*/) {
+    if (!materializar()) return false;
+    // Rellena todo lo que cae fuera de la fuente
+    return transformarAfin(matriz, {{matrizIdentidad(), ancho, alto}}, nuevoAncho, nuevoAlto, fillColor);
+}
+
+bool Imagen::transformarAfin(const MatrizAfin& matriz, const std::vector<ZonaValida>& zonas, int nuevoAncho,
+                             int nuevoAlto, unsigned char fillColor) {
+    using namespace std;
+    using namespace std::chrono;
+
+    auto inicio = high_resolution_clock::now();
+    struct rusage usage_before, usage_after;
+    getrusage(RUSAGE_SELF, &usage_before);
+    struct mallinfo2 mem_before = mallinfo2();
+    size_t buddy_before = allocador ? allocador->estadisticas().bytesEnUso : 0;
+
+    MatrizAfin inversa;
+    if (!invertirAfin(matriz, inversa) || nuevoAncho <= 0 || nuevoAlto <= 0) {
+        cerr << "Error: Transformación afín no invertible o sin área." << endl;
+        return false;
+    }
+
+    BuddyAllocator::PuntoControl puntoControl(allocador);
+    size_t nuevoPaso;
+    unsigned char* nuevosPixeles = reservarPixeles(nuevoAncho, nuevoAlto, nuevoPaso);
+    if (!nuevosPixeles) {
+        cerr << "Error: No se pudo asignar memoria para la transformación afín." << endl;
+        return false;
+    }
+    puntoControl.conservar(nuevosPixeles);
+
+    remuestrearAfin(inversa, zonas, fillColor, nuevoAncho, nuevoAlto, nuevosPixeles, nuevoPaso);
+
+    reemplazarPixeles(nuevosPixeles, nuevoPaso, origenReserva());
+    ancho = nuevoAncho;
+    alto = nuevoAlto;
+
+    auto fin = high_resolution_clock::now();
+    getrusage(RUSAGE_SELF, &usage_after);
+    struct mallinfo2 mem_after = mallinfo2();
+    auto duracion = duration_cast<milliseconds>(fin - inicio).count();
+
+    const double (*m)[3] = matriz.m;
+    cout << "\n[INFO] Transformación afín ([" << m[0][0] << " " << m[0][1] << " " << m[0][2] << "; "
+         << m[1][0] << " " << m[1][1] << " " << m[1][2] << "]"
+         << (precision == Precision::PuntoFijo ? ", punto fijo" : "") << "):" << endl;
     cout << "  Tiempo de procesamiento: " << duracion << " ms" << endl;
-    cout << "  Memoria utilizada: " << (mem_after.uordblks - mem_before.uordblks) / 1024.0 << " KB" << endl;
+    if (allocador) {
+        BuddyAllocator::Estadisticas buddy_after = allocador->estadisticas();
+        cout << "  Memoria utilizada (Buddy): "
+             << (static_cast<double>(buddy_after.bytesEnUso) - static_cast<double>(buddy_before)) / 1024.0
+             << " KB (pico de la arena: " << buddy_after.picoBytesEnUso / 1024.0 << " KB)" << endl;
+    } else {
+        cout << "  Memoria utilizada: " << (mem_after.uordblks - mem_before.uordblks) / 1024.0 << " KB" << endl;
+    }
     cout << "  CPU User: " << (usage_after.ru_utime.tv_sec - usage_before.ru_utime.tv_sec) * 1000.0 +
             (usage_after.ru_utime.tv_usec - usage_before.ru_utime.tv_usec) / 1000.0 << " ms" << endl;
     cout << "  CPU System: " << (usage_after.ru_stime.tv_sec - usage_before.ru_stime.tv_sec) * 1000.0 +
             (usage_after.ru_stime.tv_usec - usage_before.ru_stime.tv_usec) / 1000.0 << " ms" << endl;
     cout << "  Nuevas dimensiones: " << ancho << " x " << alto << endl;
+    return true;
 }
 
 
-void Imagen::guardarImagen(const std::string& nombreArchivo) const {
-    unsigned char* buffer = new unsigned char[alto * ancho * canales];
-    int index = 0;
+// --- Plan diferido ---
 
-    for (int y = 0; y < alto; y++) {
-        for (int x = 0; x < ancho; x++) {
-            for (int c = 0; c < canales; c++) {
-                buffer[index++] = pixeles[y][x][c];
+void Imagen::planificarEscalado(float factor, Filtro filtro) {
+    planificarEscalado(factor, factor, filtro);
+}
+
+void Imagen::planificarEscalado(float factorX, float factorY, Filtro filtro) {
+    Paso paso = {Paso::Tipo::Escalar};
+    paso.escalado.factorX = factorX;
+    paso.escalado.factorY = factorY;
+    paso.filtro = filtro;
+    plan.push_back(paso);
+}
+
+void Imagen::planificarRedimension(int anchoObjetivo, int altoObjetivo, Ajuste ajuste, Filtro filtro) {
+    Paso paso = {Paso::Tipo::Redimensionar};
+    paso.nuevoAncho = anchoObjetivo;
+    paso.nuevoAlto = altoObjetivo;
+    paso.ajuste = ajuste;
+    paso.filtro = filtro;
+    plan.push_back(paso);
+}
+
+void Imagen::planificarRotacion(double angulo, unsigned char fillColor) {
+    Paso paso = {Paso::Tipo::Rotar};
+    paso.parametro = angulo;
+    paso.fillColor = fillColor;
+    plan.push_back(paso);
+}
+
+void Imagen::planificarInversion() {
+    Paso paso = {Paso::Tipo::Tabla};
+    for (int v = 0; v < 256; v++) paso.tabla[v] = static_cast<unsigned char>(255 - v);
+    plan.push_back(paso);
+}
+
+std::vector<Imagen::Paso> Imagen::optimizarPlan() const {
+    std::vector<Paso> optimizado;
+    int anchoPaso = ancho;   // Dimensiones a la entrada del paso en curso
+    int altoPaso = alto;
+    // Dimensiones a la entrada del último paso geométrico del plan
+    // optimizado (-1 si se desconocen)
+    int anchoEntrada = -1;
+    int altoEntrada = -1;
+
+    for (const Paso& original : plan) {
+        Paso paso = original;
+
+        if (paso.tipo == Paso::Tipo::Tabla) {
+            // Tablas seguidas: una sola, composición de todas; si queda la
+            // identidad (p. ej. dos inversiones) desaparece
+            if (!optimizado.empty() && optimizado.back().tipo == Paso::Tipo::Tabla) {
+                Paso& anterior = optimizado.back();
+                for (int v = 0; v < 256; v++) anterior.tabla[v] = paso.tabla[anterior.tabla[v]];
+            } else {
+                optimizado.push_back(paso);
             }
+            bool identidad = true;
+            for (int v = 0; v < 256 && identidad; v++) identidad = (optimizado.back().tabla[v] == v);
+            if (identidad) optimizado.pop_back();
+            continue;
+        }
+
+        // Los escalados se resuelven con las dimensiones a la entrada del
+        // paso: factores, tamaño de salida y recorte
+        if (paso.tipo == Paso::Tipo::Redimensionar) {
+            paso.escalado = escaladoPorTamano(anchoPaso, altoPaso, paso.nuevoAncho, paso.nuevoAlto, paso.ajuste);
+            paso.tipo = Paso::Tipo::Escalar;
+        } else if (paso.tipo == Paso::Tipo::Escalar) {
+            paso.escalado = escaladoPorFactores(anchoPaso, altoPaso, paso.escalado.factorX, paso.escalado.factorY);
+        }
+
+        // Pasos nulos: factor 1 en ambos ejes (cualquier filtro devuelve la
+        // fuente tal cual) y vueltas completas
+        if (paso.tipo == Paso::Tipo::Escalar && paso.escalado.factorX == 1.0f && paso.escalado.factorY == 1.0f &&
+            paso.escalado.nuevoAncho == anchoPaso && paso.escalado.nuevoAlto == altoPaso) {
+            continue;
         }
+        if (paso.tipo == Paso::Tipo::Rotar && cuartosDeVuelta(paso.parametro) == 0) continue;
+
+        // Dimensiones y matriz del paso por separado
+        if (paso.tipo == Paso::Tipo::Escalar) {
+            const Escalado& escalado = paso.escalado;
+            paso.nuevoAncho = escalado.nuevoAncho;
+            paso.nuevoAlto = escalado.nuevoAlto;
+            paso.matriz = componerAfin(matrizTraslacion(-escalado.origenX, -escalado.origenY),
+                                       matrizEscalado(escalado.factorX, escalado.factorY));
+        } else {
+            dimensionesRotacion(anchoPaso, altoPaso, paso.parametro, paso.nuevoAncho, paso.nuevoAlto);
+            paso.matriz = matrizRotacion(paso.parametro, anchoPaso, altoPaso, paso.nuevoAncho, paso.nuevoAlto);
+            paso.zonas = {{matrizIdentidad(), anchoPaso, altoPaso}};
+        }
+        const int anchoPrevio = anchoPaso;
+        const int altoPrevio = altoPaso;
+        anchoPaso = paso.nuevoAncho;
+        altoPaso = paso.nuevoAlto;
+
+        // Cuartos de vuelta seguidos: un solo giro exacto; si suman vueltas
+        // completas desaparecen
+        auto cuartoDeVuelta = [](const Paso& p) {
+            return p.tipo == Paso::Tipo::Rotar && cuartosDeVuelta(p.parametro) > 0;
+        };
+        if (!optimizado.empty() && cuartoDeVuelta(optimizado.back()) && cuartoDeVuelta(paso)) {
+            Paso& anterior = optimizado.back();
+            anterior.parametro += paso.parametro;
+            anterior.matriz = componerAfin(paso.matriz, anterior.matriz);
+            anterior.nuevoAncho = paso.nuevoAncho;
+            anterior.nuevoAlto = paso.nuevoAlto;
+            if (cuartosDeVuelta(anterior.parametro) == 0) {
+                optimizado.pop_back();
+                anchoEntrada = altoEntrada = -1;
+            }
+            continue;
+        }
+
+        // Geometría seguida: se compone con el paso anterior si ambos son
+        // cambios de coordenadas con interpolación bilineal (no los
+        // escalados filtrados ni los cuartos de vuelta, que girarExacto
+        // resuelve sin interpolar) y no rellenan con colores distintos
+        auto componible = [&cuartoDeVuelta](const Paso& p) {
+            return (p.tipo == Paso::Tipo::Rotar && !cuartoDeVuelta(p)) || p.tipo == Paso::Tipo::Afin ||
+                   (p.tipo == Paso::Tipo::Escalar && escaladoAfin(p.escalado, p.filtro));
+        };
+        if (!optimizado.empty() && componible(optimizado.back()) && componible(paso)) {
+            Paso& anterior = optimizado.back();
+            bool rellenoCompatible = paso.tipo == Paso::Tipo::Escalar || anterior.tipo == Paso::Tipo::Escalar ||
+                                     anterior.fillColor == paso.fillColor;
+            if (rellenoCompatible) {
+                // Una rotación rellena lo que cae fuera de su entrada, no de
+                // la fuente; los escalados replican el borde y no rellenan
+                if (paso.tipo == Paso::Tipo::Rotar) {
+                    anterior.fillColor = paso.fillColor;
+                    anterior.zonas.push_back({anterior.matriz, anchoPrevio, altoPrevio});
+                }
+                anterior.tipo = Paso::Tipo::Afin;
+                anterior.matriz = componerAfin(paso.matriz, anterior.matriz);
+                anterior.nuevoAncho = paso.nuevoAncho;
+                anterior.nuevoAlto = paso.nuevoAlto;
+                // Si la composición vuelve al punto de partida (p. ej.
+                // escalar 2 y escalar 0.5) sin rellenar nada, el paso
+                // desaparece
+                if (anterior.zonas.empty() && anterior.nuevoAncho == anchoEntrada &&
+                    anterior.nuevoAlto == altoEntrada && esIdentidad(anterior.matriz, anchoEntrada, altoEntrada)) {
+                    optimizado.pop_back();
+                    anchoEntrada = altoEntrada = -1;
+                }
+                continue;
+            }
+        }
+        anchoEntrada = anchoPrevio;
+        altoEntrada = altoPrevio;
+        optimizado.push_back(paso);
     }
+    return optimizado;
+}
+
+bool Imagen::materializar() {
+    if (plan.empty()) return true;
+
+    std::vector<Paso> pasos = optimizarPlan();
+    const size_t operaciones = plan.size();
+    plan.clear();
+    cout << "\n[INFO] Plan diferido: " << operaciones << " operaciones en " << pasos.size() << " pasos" << endl;
 
-    stbi_write_png(nombreArchivo.c_str(), ancho, alto, canales, buffer, ancho * canales);
-    delete[] buffer;
+    bool correcto = true;
+    for (size_t i = 0; i < pasos.size() && correcto; i++) {
+        const Paso& paso = pasos[i];
+
+        // Una tabla tras un remuestreo se aplica a cada fila de salida
+        // recién escrita, sin otra pasada sobre la imagen
+        bool fundirTabla = paso.tipo != Paso::Tipo::Tabla && i + 1 < pasos.size() &&
+                           pasos[i + 1].tipo == Paso::Tipo::Tabla;
+        tablaSalida = fundirTabla ? pasos[i + 1].tabla.data() : nullptr;
+
+        switch (paso.tipo) {
+            case Paso::Tipo::Escalar:
+                correcto = escalarRegion(paso.escalado, paso.filtro);
+                break;
+            case Paso::Tipo::Redimensionar:
+                // optimizarPlan los convierte en Escalar
+                break;
+            case Paso::Tipo::Rotar:
+                correcto = rotarImagen(paso.parametro, paso.fillColor);
+                break;
+            case Paso::Tipo::Afin:
+                correcto = transformarAfin(paso.matriz, paso.zonas, paso.nuevoAncho, paso.nuevoAlto, paso.fillColor);
+                break;
+            case Paso::Tipo::Tabla: {
+                // Tabla sin remuestreo previo: en el sitio
+                const size_t bytesFila = static_cast<size_t>(ancho) * canales;
+                #pragma omp parallel for
+                for (int y = 0; y < alto; y++) {
+                    aplicarTabla(fila(y), bytesFila, paso.tabla.data());
+                }
+                break;
+            }
+        }
+
+        tablaSalida = nullptr;
+        if (fundirTabla) i++;
+    }
+    return correcto;
+}
+
+void Imagen::aplicarTablaSalida(unsigned char* datos, size_t bytes) const {
+    if (tablaSalida) aplicarTabla(datos, bytes, tablaSalida);
+}
+
+// Guarda la imagen en PNG. El escritor recibe directamente el buffer de
+// pixeles junto con su paso, sin copia intermedia.
+bool Imagen::guardarImagen(const std::string& nombreArchivo) {
+    if (!materializar()) return false;
+    if (!stbi_write_png(nombreArchivo.c_str(), ancho, alto, canales, pixeles, static_cast<int>(paso))) {
+        std::cerr << "Error al guardar la imagen: " << nombreArchivo << std::endl;
+        return false;
+    }
 
     std::cout << "[OK] Imagen guardada en: " << nombreArchivo << std::endl;
+    return true;
+}
+
+std::string Imagen::rutaNivel(const std::string& rutaSalida, int anchoNivel, int altoNivel) {
+    size_t punto = rutaSalida.find_last_of('.');
+    size_t barra = rutaSalida.find_last_of('/');
+    if (punto == std::string::npos || (barra != std::string::npos && punto < barra)) {
+        punto = rutaSalida.size();
+    }
+    return rutaSalida.substr(0, punto) + "_" + std::to_string(anchoNivel) + "x" + std::to_string(altoNivel) +
+           rutaSalida.substr(punto);
+}
+
+bool Imagen::guardarPiramide(const std::vector<int>& niveles, const std::string& rutaSalida) {
+    if (!materializar()) return false;
+    auto inicio = high_resolution_clock::now();
+    size_t buddy_before = allocador ? allocador->estadisticas().bytesEnUso : 0;
+
+    int profundidad = 0;
+    for (int nivel : niveles) profundidad = std::max(profundidad, nivel);
+
+    // Dimensiones de cada nivel; el nivel 0 es la propia imagen
+    struct Nivel {
+        int ancho, alto;
+        size_t paso;
+        unsigned char* pixeles;
+    };
+    std::vector<Nivel> piramide(profundidad + 1);
+    piramide[0] = {ancho, alto, paso, pixeles};
+    for (int k = 1; k <= profundidad; k++) {
+        piramide[k].ancho = piramide[k - 1].ancho / 2;
+        piramide[k].alto = piramide[k - 1].alto / 2;
+        piramide[k].pixeles = nullptr;
+        if (piramide[k].ancho == 0 || piramide[k].alto == 0) {
+            cerr << "Error: La imagen de " << ancho << "x" << alto << " no admite " << profundidad
+                 << " niveles de pirámide." << endl;
+            return false;
+        }
+    }
+
+    // Todos los temporales vuelven a la arena al terminar
+    BuddyAllocator::PuntoControl puntoControl(allocador);
+    for (int k = 1; k <= profundidad; k++) {
+        piramide[k].pixeles = reservarPixeles(piramide[k].ancho, piramide[k].alto, piramide[k].paso);
+        if (!piramide[k].pixeles) {
+            cerr << "Error: No se pudo asignar memoria para la pirámide." << endl;
+            for (int j = 1; j < k; j++) liberarPixeles(piramide[j].pixeles, origenReserva(), allocador);
+            return false;
+        }
+    }
+
+    // Bandas de 'filasBanda' filas del último nivel (filasBanda << (N - k)
+    // filas del nivel k), con la banda del nivel 0 en torno a 512 KB. Cada
+    // hilo recorre su banda nivel a nivel, leyendo filas que acaba de escribir.
+    const int altoUltimo = piramide[profundidad].alto;
+    const size_t bytesBanda = 512 * 1024;
+    int filasBanda = static_cast<int>(std::max<size_t>(1, (bytesBanda / paso) >> profundidad));
+    filasBanda = std::min(filasBanda, altoUltimo);
+    const int bandas = (altoUltimo + filasBanda - 1) / filasBanda;
+
+    std::pmr::memory_resource* recurso = recursoTemporales();
+    #pragma omp parallel
+    {
+        std::pmr::vector<uint16_t> acumulador(static_cast<size_t>(piramide[1].ancho) * 2 * canales, recurso);
+
+        #pragma omp for schedule(dynamic)
+        for (int banda = 0; banda < bandas; banda++) {
+            for (int k = 1; k <= profundidad; k++) {
+                const Nivel& fuente = piramide[k - 1];
+                const Nivel& destino = piramide[k];
+                // La última banda se queda además las filas que sobran al
+                // redondear hacia abajo las alturas de los niveles inferiores
+                int desde = (banda * filasBanda) << (profundidad - k);
+                int hasta = (banda == bandas - 1) ? destino.alto : ((banda + 1) * filasBanda) << (profundidad - k);
+                for (int y = desde; y < hasta; y++) {
+                    reducirFilaCaja(fuente.pixeles + static_cast<size_t>(2 * y) * fuente.paso, fuente.paso, 2,
+                                    destino.pixeles + static_cast<size_t>(y) * destino.paso,
+                                    destino.ancho, canales, acumulador.data());
+                }
+            }
+        }
+    }
+
+    auto fin = high_resolution_clock::now();
+    auto duracion = duration_cast<milliseconds>(fin - inicio).count();
+    cout << "\n[INFO] Pirámide de imagen (" << profundidad << " niveles):" << endl;
+    cout << "  Tiempo de procesamiento: " << duracion << " ms" << endl;
+    if (allocador) {
+        BuddyAllocator::Estadisticas buddy_after = allocador->estadisticas();
+        cout << "  Memoria utilizada (Buddy): "
+             << (static_cast<double>(buddy_after.bytesEnUso) - static_cast<double>(buddy_before)) / 1024.0
+             << " KB (pico de la arena: " << buddy_after.picoBytesEnUso / 1024.0 << " KB)" << endl;
+    }
+
+    bool correcto = true;
+    for (int nivel : niveles) {
+        const Nivel& n = piramide[nivel];
+        std::string ruta = rutaNivel(rutaSalida, n.ancho, n.alto);
+        if (!stbi_write_png(ruta.c_str(), n.ancho, n.alto, canales, n.pixeles, static_cast<int>(n.paso))) {
+            cerr << "Error al guardar la imagen: " << ruta << endl;
+            correcto = false;
+            continue;
+        }
+        cout << "[OK] Nivel " << nivel << " (" << n.ancho << "x" << n.alto << ") guardado en: " << ruta << endl;
+    }
+
+    for (int k = 1; k <= profundidad; k++) {
+        liberarPixeles(piramide[k].pixeles, origenReserva(), allocador);
+    }
+    return correcto;
 }
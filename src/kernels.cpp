@@ -0,0 +1,1081 @@
+/// Archivo: kernels.cpp
+/// Núcleos por fila (escalar y AVX2) para las operaciones de Imagen
+
+#include "kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+// Los núcleos se instancian con el número de canales como constante
+// (CANALES = 1..4): el compilador desenrolla el bucle por canales, fija los
+// desplazamientos entre muestras y mantiene las muestras en registros.
+// CANALES = 0 es la versión genérica, con el número de canales en tiempo
+// de ejecución. Las funciones públicas eligen la instancia una vez por
+// llamada con despacharCanales.
+template <int CANALES>
+static inline int numeroCanales(int canales) {
+    return CANALES ? CANALES : canales;
+}
+
+// Llama a nucleo(std::integral_constant<int, CANALES>) con la instancia
+// que corresponde a 'canales'.
+template <typename Nucleo>
+static inline auto despacharCanales(int canales, Nucleo&& nucleo) {
+    switch (canales) {
+        case 1:  return nucleo(std::integral_constant<int, 1>());
+        case 2:  return nucleo(std::integral_constant<int, 2>());
+        case 3:  return nucleo(std::integral_constant<int, 3>());
+        case 4:  return nucleo(std::integral_constant<int, 4>());
+        default: return nucleo(std::integral_constant<int, 0>());
+    }
+}
+
+// Versión escalar de referencia para los pixeles [xInicio, xFin).
+// El orden de las operaciones en coma flotante fija el resultado: la
+// versión AVX2 lo replica exactamente.
+template <int CANALES>
+__attribute__((always_inline))
+static inline void escalarFilaBilinealEscalarT(const unsigned char* fila1, const unsigned char* fila2,
+                                               unsigned char* destino, const TablaHorizontal& tabla, int xInicio,
+                                               int xFin, int canalesDinamicos, float dy) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    for (int x = xInicio; x < xFin; x++) {
+        float dx = tabla.pesos[x];
+
+        const unsigned char* p11 = fila1 + tabla.desplazamientos1[x];
+        const unsigned char* p12 = fila1 + tabla.desplazamientos2[x];
+        const unsigned char* p21 = fila2 + tabla.desplazamientos1[x];
+        const unsigned char* p22 = fila2 + tabla.desplazamientos2[x];
+
+        for (int c = 0; c < canales; c++) {
+            float valor =
+                p11[c] * (1 - dx) * (1 - dy) +
+                p12[c] * dx * (1 - dy) +
+                p21[c] * (1 - dx) * dy +
+                p22[c] * dx * dy;
+
+            destino[x * canales + c] = static_cast<unsigned char>(valor);
+        }
+    }
+}
+
+void escalarFilaBilinealEscalar(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                const TablaHorizontal& tabla, int xInicio, int xFin, int canales, float dy) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        escalarFilaBilinealEscalarT<decltype(canalesFijos)::value>(fila1, fila2, destino, tabla, xInicio, xFin,
+                                                                   canales, dy);
+    });
+}
+
+// Carga los bytes fila[indices[i]] de 8 lanes como enteros de 32 bits.
+// Cada gather lee 4 bytes por lane; el llamador garantiza que no se sale
+// de la fila.
+__attribute__((target("avx2")))
+static inline __m256i cargarCanalEntero(const unsigned char* fila, __m256i indices) {
+    __m256i bytes = _mm256_i32gather_epi32(reinterpret_cast<const int*>(fila), indices, 1);
+    return _mm256_and_si256(bytes, _mm256_set1_epi32(0xFF));
+}
+
+__attribute__((target("avx2")))
+static inline __m256 cargarCanal(const unsigned char* fila, __m256i indices) {
+    return _mm256_cvtepi32_ps(cargarCanalEntero(fila, indices));
+}
+
+// Los gathers de 4 bytes del bloque de 'pixeles' pixeles que empieza en x
+// quedan dentro de la fila fuente (el último lane es el que lee más a la
+// derecha).
+static inline bool bloqueDentroDeFila(const TablaHorizontal& tabla, int x, int pixeles, int canales, int bytesFila) {
+    return tabla.desplazamientos2[x + pixeles - 1] + canales - 1 + 4 <= bytesFila;
+}
+
+// Escribe 8 pixeles de salida a partir de un vector de 8 valores (0..255)
+// por canal. Con 1 a 4 canales los bytes se intercalan en registros:
+// cada lane de 32 bits reúne los canales de un pixel y los shuffles de
+// anchura fija quitan los huecos.
+template <int CANALES>
+__attribute__((target("avx2")))
+static inline void intercalarCanales(unsigned char* salida, const __m256i* valores, int canalesDinamicos) {
+    if constexpr (CANALES == 1) {
+        // 32 -> 16 -> 8 bits; cada mitad de 128 bits deja sus 4 bytes en
+        // el primer dword
+        __m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(valores[0], valores[0]),
+                                            _mm256_setzero_si256());
+        bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(salida), _mm256_castsi256_si128(bytes));
+    } else if constexpr (CANALES == 2) {
+        __m256i pares = _mm256_or_si256(valores[0], _mm256_slli_epi32(valores[1], 8));
+        __m256i palabras = _mm256_permute4x64_epi64(_mm256_packus_epi32(pares, pares), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(salida), _mm256_castsi256_si128(palabras));
+    } else if constexpr (CANALES == 3) {
+        __m256i pixeles = _mm256_or_si256(_mm256_or_si256(valores[0], _mm256_slli_epi32(valores[1], 8)),
+                                          _mm256_slli_epi32(valores[2], 16));
+        // 4 pixeles de 3 bytes por mitad de 128 bits
+        const __m256i compactar = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                   0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+        alignas(32) unsigned char bytes[32];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(bytes), _mm256_shuffle_epi8(pixeles, compactar));
+        std::memcpy(salida, bytes, 12);
+        std::memcpy(salida + 12, bytes + 16, 12);
+    } else if constexpr (CANALES == 4) {
+        __m256i pixeles = _mm256_or_si256(_mm256_or_si256(valores[0], _mm256_slli_epi32(valores[1], 8)),
+                                          _mm256_or_si256(_mm256_slli_epi32(valores[2], 16),
+                                                          _mm256_slli_epi32(valores[3], 24)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(salida), pixeles);
+    } else {
+        const int canales = canalesDinamicos;
+        alignas(32) int32_t canal[4][8];
+        for (int c = 0; c < canales; c++) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(canal[c]), valores[c]);
+        }
+        for (int i = 0; i < 8; i++) {
+            for (int c = 0; c < canales; c++) {
+                salida[i * canales + c] = static_cast<unsigned char>(canal[c][i]);
+            }
+        }
+    }
+}
+
+// Procesa 8 pixeles de salida por iteración desde xInicio. Devuelve el
+// primer pixel que no ha escrito: el resto de la fila (donde los gathers de
+// 4 bytes podrían leer más allá del final de la fila fuente) queda para la
+// versión escalar.
+template <int CANALES>
+__attribute__((target("avx2")))
+static int escalarFilaBilinealAVX2T(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                    int bytesFila, const TablaHorizontal& tabla, int xInicio, int nuevoAncho,
+                                    int canalesDinamicos, float dy) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    const __m256 vUno = _mm256_set1_ps(1.0f);
+    const __m256 vDy = _mm256_set1_ps(dy);
+    const __m256 vUnoMenosDy = _mm256_set1_ps(1 - dy);
+
+    __m256i valores[4];
+
+    int x = xInicio;
+    for (; x + 8 <= nuevoAncho; x += 8) {
+        if (!bloqueDentroDeFila(tabla, x, 8, canales, bytesFila)) break;
+
+        __m256i base1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tabla.desplazamientos1 + x));
+        __m256i base2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tabla.desplazamientos2 + x));
+        __m256 dx = _mm256_loadu_ps(tabla.pesos + x);
+        __m256 unoMenosDx = _mm256_sub_ps(vUno, dx);
+
+        for (int c = 0; c < canales; c++) {
+            __m256i desp = _mm256_set1_epi32(c);
+            __m256i i1 = _mm256_add_epi32(base1, desp);
+            __m256i i2 = _mm256_add_epi32(base2, desp);
+
+            // Mismo orden que la versión escalar: ((p * wx) * wy), sumados en orden
+            __m256 t11 = _mm256_mul_ps(_mm256_mul_ps(cargarCanal(fila1, i1), unoMenosDx), vUnoMenosDy);
+            __m256 t12 = _mm256_mul_ps(_mm256_mul_ps(cargarCanal(fila1, i2), dx), vUnoMenosDy);
+            __m256 t21 = _mm256_mul_ps(_mm256_mul_ps(cargarCanal(fila2, i1), unoMenosDx), vDy);
+            __m256 t22 = _mm256_mul_ps(_mm256_mul_ps(cargarCanal(fila2, i2), dx), vDy);
+            __m256 valor = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(t11, t12), t21), t22);
+
+            valores[c] = _mm256_cvttps_epi32(valor);
+        }
+
+        intercalarCanales<CANALES>(destino + x * canales, valores, canales);
+    }
+    return x;
+}
+
+int escalarFilaBilinealAVX2(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                            int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, float dy) {
+    if (canales > 4) return 0;
+    return despacharCanales(canales, [&](auto canalesFijos) {
+        return escalarFilaBilinealAVX2T<decltype(canalesFijos)::value>(fila1, fila2, destino, bytesFila, tabla, 0,
+                                                                       nuevoAncho, canales, dy);
+    });
+}
+
+// --- Punto fijo ---
+
+template <int CANALES>
+__attribute__((always_inline))
+static inline void escalarFilaBilinealFijaEscalarT(const unsigned char* fila1, const unsigned char* fila2,
+                                                   unsigned char* destino, const TablaHorizontal& tabla, int xInicio,
+                                                   int xFin, int canalesDinamicos, int pesoY) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    for (int x = xInicio; x < xFin; x++) {
+        const int d1 = tabla.desplazamientos1[x];
+        const int d2 = tabla.desplazamientos2[x];
+        const int wx = tabla.pesosFijos[x];
+        for (int c = 0; c < canales; c++) {
+            destino[x * canales + c] =
+                bilinealFija(fila1[d1 + c], fila1[d2 + c], fila2[d1 + c], fila2[d2 + c], wx, pesoY);
+        }
+    }
+}
+
+void escalarFilaBilinealFijaEscalar(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                    const TablaHorizontal& tabla, int xInicio, int xFin, int canales, int pesoY) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        escalarFilaBilinealFijaEscalarT<decltype(canalesFijos)::value>(fila1, fila2, destino, tabla, xInicio, xFin,
+                                                                       canales, pesoY);
+    });
+}
+
+// Interpolación de dos muestras por lane con un único pmaddwd: (a, b) y
+// (pesoA, pesoB) van empaquetados como pares de 16 bits en cada lane de 32.
+__attribute__((target("avx2")))
+static inline __m256i mezclarPares(__m256i a, __m256i b, __m256i pesos) {
+    return _mm256_madd_epi16(_mm256_or_si256(a, _mm256_slli_epi32(b, 16)), pesos);
+}
+
+// Igual que escalarFilaBilinealAVX2: 8 pixeles por iteración, y el resto de
+// la fila queda para la versión escalar. Produce los mismos bytes que ella.
+template <int CANALES>
+__attribute__((target("avx2")))
+static int escalarFilaBilinealFijaAVX2T(const unsigned char* fila1, const unsigned char* fila2,
+                                        unsigned char* destino, int bytesFila, const TablaHorizontal& tabla,
+                                        int xInicio, int nuevoAncho, int canalesDinamicos, int pesoY) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    const __m256i vPesoUno = _mm256_set1_epi32(PESO_UNO);
+    const __m256i vPesosY = _mm256_set1_epi32((PESO_UNO - pesoY) | (pesoY << 16));
+    const __m256i vRedondeo = _mm256_set1_epi32(1 << (2 * BITS_PESO - 1));
+
+    __m256i valores[4];
+
+    int x = xInicio;
+    for (; x + 8 <= nuevoAncho; x += 8) {
+        if (!bloqueDentroDeFila(tabla, x, 8, canales, bytesFila)) break;
+
+        __m256i d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tabla.desplazamientos1 + x));
+        __m256i d2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tabla.desplazamientos2 + x));
+        __m256i wx = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tabla.pesosFijos + x)));
+        __m256i pesosX8 = _mm256_or_si256(_mm256_sub_epi32(vPesoUno, wx), _mm256_slli_epi32(wx, 16));
+
+        for (int c = 0; c < canales; c++) {
+            __m256i desp = _mm256_set1_epi32(c);
+            __m256i i1 = _mm256_add_epi32(d1, desp);
+            __m256i i2 = _mm256_add_epi32(d2, desp);
+
+            __m256i arriba = mezclarPares(cargarCanalEntero(fila1, i1), cargarCanalEntero(fila1, i2), pesosX8);
+            __m256i abajo = mezclarPares(cargarCanalEntero(fila2, i1), cargarCanalEntero(fila2, i2), pesosX8);
+            __m256i valor = mezclarPares(arriba, abajo, vPesosY);
+
+            valores[c] = _mm256_srli_epi32(_mm256_add_epi32(valor, vRedondeo), 2 * BITS_PESO);
+        }
+
+        intercalarCanales<CANALES>(destino + x * canales, valores, canales);
+    }
+    return x;
+}
+
+int escalarFilaBilinealFijaAVX2(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, int pesoY) {
+    if (canales > 4) return 0;
+    return despacharCanales(canales, [&](auto canalesFijos) {
+        return escalarFilaBilinealFijaAVX2T<decltype(canalesFijos)::value>(fila1, fila2, destino, bytesFila, tabla,
+                                                                           0, nuevoAncho, canales, pesoY);
+    });
+}
+
+// --- AVX-512 ---
+//
+// Los mismos núcleos de escalado con 16 pixeles por iteración. Requieren
+// AVX-512F (gathers, conversiones) y AVX-512BW (pmaddwd y pshufb de 512
+// bits), y producen los mismos bytes que las versiones AVX2 y escalar.
+//
+// GCC 12 avisa de '__Y' sin inicializar dentro de las cabeceras de
+// AVX-512 (_mm512_undefined_*, falso positivo corregido en GCC 13); el
+// aviso se silencia sólo en estos núcleos.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i cargarCanalEntero16(const unsigned char* fila, __m512i indices) {
+    __m512i bytes = _mm512_i32gather_epi32(indices, fila, 1);
+    return _mm512_and_si512(bytes, _mm512_set1_epi32(0xFF));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512 cargarCanal16(const unsigned char* fila, __m512i indices) {
+    return _mm512_cvtepi32_ps(cargarCanalEntero16(fila, indices));
+}
+
+// Como intercalarCanales, para 16 pixeles; con 1 y 2 canales basta con
+// las conversiones con truncamiento (vpmovdb / vpmovdw).
+template <int CANALES>
+__attribute__((target("avx512f,avx512bw")))
+static inline void intercalarCanales16(unsigned char* salida, const __m512i* valores) {
+    static_assert(CANALES >= 1 && CANALES <= 4, "AVX-512 sólo para 1 a 4 canales");
+    if constexpr (CANALES == 1) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(salida), _mm512_cvtepi32_epi8(valores[0]));
+    } else if constexpr (CANALES == 2) {
+        __m512i pares = _mm512_or_si512(valores[0], _mm512_slli_epi32(valores[1], 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(salida), _mm512_cvtepi32_epi16(pares));
+    } else if constexpr (CANALES == 3) {
+        __m512i pixeles = _mm512_or_si512(_mm512_or_si512(valores[0], _mm512_slli_epi32(valores[1], 8)),
+                                          _mm512_slli_epi32(valores[2], 16));
+        const __m512i compactar = _mm512_broadcast_i32x4(
+            _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+        alignas(64) unsigned char bytes[64];
+        _mm512_store_si512(bytes, _mm512_shuffle_epi8(pixeles, compactar));
+        for (int i = 0; i < 4; i++) {
+            std::memcpy(salida + 12 * i, bytes + 16 * i, 12);
+        }
+    } else {
+        __m512i pixeles = _mm512_or_si512(_mm512_or_si512(valores[0], _mm512_slli_epi32(valores[1], 8)),
+                                          _mm512_or_si512(_mm512_slli_epi32(valores[2], 16),
+                                                          _mm512_slli_epi32(valores[3], 24)));
+        _mm512_storeu_si512(salida, pixeles);
+    }
+}
+
+template <int CANALES>
+__attribute__((target("avx512f,avx512bw")))
+static int escalarFilaBilinealAVX512T(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                      int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, float dy) {
+    const __m512 vUno = _mm512_set1_ps(1.0f);
+    const __m512 vDy = _mm512_set1_ps(dy);
+    const __m512 vUnoMenosDy = _mm512_set1_ps(1 - dy);
+
+    __m512i valores[CANALES];
+
+    int x = 0;
+    for (; x + 16 <= nuevoAncho; x += 16) {
+        if (!bloqueDentroDeFila(tabla, x, 16, CANALES, bytesFila)) break;
+
+        __m512i base1 = _mm512_loadu_si512(tabla.desplazamientos1 + x);
+        __m512i base2 = _mm512_loadu_si512(tabla.desplazamientos2 + x);
+        __m512 dx = _mm512_loadu_ps(tabla.pesos + x);
+        __m512 unoMenosDx = _mm512_sub_ps(vUno, dx);
+
+        for (int c = 0; c < CANALES; c++) {
+            __m512i desp = _mm512_set1_epi32(c);
+            __m512i i1 = _mm512_add_epi32(base1, desp);
+            __m512i i2 = _mm512_add_epi32(base2, desp);
+
+            // Mismo orden que la versión escalar
+            __m512 t11 = _mm512_mul_ps(_mm512_mul_ps(cargarCanal16(fila1, i1), unoMenosDx), vUnoMenosDy);
+            __m512 t12 = _mm512_mul_ps(_mm512_mul_ps(cargarCanal16(fila1, i2), dx), vUnoMenosDy);
+            __m512 t21 = _mm512_mul_ps(_mm512_mul_ps(cargarCanal16(fila2, i1), unoMenosDx), vDy);
+            __m512 t22 = _mm512_mul_ps(_mm512_mul_ps(cargarCanal16(fila2, i2), dx), vDy);
+            __m512 valor = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(t11, t12), t21), t22);
+
+            valores[c] = _mm512_cvttps_epi32(valor);
+        }
+
+        intercalarCanales16<CANALES>(destino + x * CANALES, valores);
+    }
+    return x;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i mezclarPares16(__m512i a, __m512i b, __m512i pesos) {
+    return _mm512_madd_epi16(_mm512_or_si512(a, _mm512_slli_epi32(b, 16)), pesos);
+}
+
+template <int CANALES>
+__attribute__((target("avx512f,avx512bw")))
+static int escalarFilaBilinealFijaAVX512T(const unsigned char* fila1, const unsigned char* fila2,
+                                          unsigned char* destino, int bytesFila, const TablaHorizontal& tabla,
+                                          int nuevoAncho, int pesoY) {
+    const __m512i vPesoUno = _mm512_set1_epi32(PESO_UNO);
+    const __m512i vPesosY = _mm512_set1_epi32((PESO_UNO - pesoY) | (pesoY << 16));
+    const __m512i vRedondeo = _mm512_set1_epi32(1 << (2 * BITS_PESO - 1));
+
+    __m512i valores[CANALES];
+
+    int x = 0;
+    for (; x + 16 <= nuevoAncho; x += 16) {
+        if (!bloqueDentroDeFila(tabla, x, 16, CANALES, bytesFila)) break;
+
+        __m512i d1 = _mm512_loadu_si512(tabla.desplazamientos1 + x);
+        __m512i d2 = _mm512_loadu_si512(tabla.desplazamientos2 + x);
+        __m512i wx = _mm512_cvtepi16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tabla.pesosFijos + x)));
+        __m512i pesosX16 = _mm512_or_si512(_mm512_sub_epi32(vPesoUno, wx), _mm512_slli_epi32(wx, 16));
+
+        for (int c = 0; c < CANALES; c++) {
+            __m512i desp = _mm512_set1_epi32(c);
+            __m512i i1 = _mm512_add_epi32(d1, desp);
+            __m512i i2 = _mm512_add_epi32(d2, desp);
+
+            __m512i arriba = mezclarPares16(cargarCanalEntero16(fila1, i1), cargarCanalEntero16(fila1, i2), pesosX16);
+            __m512i abajo = mezclarPares16(cargarCanalEntero16(fila2, i1), cargarCanalEntero16(fila2, i2), pesosX16);
+            __m512i valor = mezclarPares16(arriba, abajo, vPesosY);
+
+            valores[c] = _mm512_srli_epi32(_mm512_add_epi32(valor, vRedondeo), 2 * BITS_PESO);
+        }
+
+        intercalarCanales16<CANALES>(destino + x * CANALES, valores);
+    }
+    return x;
+}
+
+#pragma GCC diagnostic pop
+
+// --- Rotación ---
+
+template <int CANALES>
+__attribute__((always_inline))
+static inline void rotarFilaBilinealT(const unsigned char* fuente, size_t paso, int canalesDinamicos,
+                                      unsigned char* destino, int xInicio, int xFin, int64_t origX, int64_t origY,
+                                      int64_t pasoX, int64_t pasoY) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    const double escala = 1.0 / static_cast<double>(int64_t(1) << BITS_COORDENADA);
+    for (int x = xInicio; x < xFin; x++, origX += pasoX, origY += pasoY) {
+        const int x1 = static_cast<int>(origX >> BITS_COORDENADA);
+        const int y1 = static_cast<int>(origY >> BITS_COORDENADA);
+        const double fx = static_cast<uint32_t>(origX) * escala;
+        const double fy = static_cast<uint32_t>(origY) * escala;
+        const double fx1 = 1.0 - fx;
+        const double fy1 = 1.0 - fy;
+
+        const unsigned char* fila1 = fuente + static_cast<size_t>(y1) * paso + x1 * canales;
+        const unsigned char* fila2 = fila1 + paso;
+
+        for (int c = 0; c < canales; c++) {
+            double p00 = fila1[c];
+            double p10 = fila1[canales + c];
+            double p01 = fila2[c];
+            double p11 = fila2[canales + c];
+
+            double interp = (fx1 * fy1 * p00) + (fx * fy1 * p10) +
+                            (fx1 * fy * p01) + (fx * fy * p11);
+
+            destino[x * canales + c] = static_cast<unsigned char>(std::round(interp));
+        }
+    }
+}
+
+template <int CANALES>
+__attribute__((always_inline))
+static inline void rotarFilaBilinealFijaT(const unsigned char* fuente, size_t paso, int canalesDinamicos,
+                                          unsigned char* destino, int xInicio, int xFin, int64_t origX, int64_t origY,
+                                          int64_t pasoX, int64_t pasoY) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    // Fracción Q32 -> peso Q7 redondeado
+    const int desplazamiento = BITS_COORDENADA - BITS_PESO;
+    const uint64_t redondeo = uint64_t(1) << (desplazamiento - 1);
+    for (int x = xInicio; x < xFin; x++, origX += pasoX, origY += pasoY) {
+        const int x1 = static_cast<int>(origX >> BITS_COORDENADA);
+        const int y1 = static_cast<int>(origY >> BITS_COORDENADA);
+        const int wx = static_cast<int>((static_cast<uint32_t>(origX) + redondeo) >> desplazamiento);
+        const int wy = static_cast<int>((static_cast<uint32_t>(origY) + redondeo) >> desplazamiento);
+
+        const unsigned char* fila1 = fuente + static_cast<size_t>(y1) * paso + x1 * canales;
+        const unsigned char* fila2 = fila1 + paso;
+
+        for (int c = 0; c < canales; c++) {
+            destino[x * canales + c] =
+                bilinealFija(fila1[c], fila1[canales + c], fila2[c], fila2[canales + c], wx, wy);
+        }
+    }
+}
+
+// Reúne los dwords altos (ALTOS) o bajos de dos vectores de 4 enteros de 64
+// bits, en orden: 'a' da los lanes 0..3 y 'b' los 4..7.
+template <bool ALTOS>
+__attribute__((target("avx2")))
+static inline __m256i reunirDwords(__m256i a, __m256i b) {
+    constexpr int orden = ALTOS ? _MM_SHUFFLE(3, 1, 3, 1) : _MM_SHUFFLE(2, 0, 2, 0);
+    __m256 mezcla = _mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), orden);
+    // Queda (0, 1, 4, 5 | 2, 3, 6, 7): se reordenan los pares
+    return _mm256_permute4x64_epi64(_mm256_castps_si256(mezcla), 0xD8);
+}
+
+// Como cargarCanalEntero, pero cada gather lee los 4 bytes que acaban en el
+// pedido: nunca pasa del último byte de la imagen (sí lee hasta 3 antes).
+__attribute__((target("avx2")))
+static inline __m256i cargarCanalHaciaAtras(const unsigned char* fila, __m256i indices) {
+    __m256i bytes = _mm256_i32gather_epi32(reinterpret_cast<const int*>(fila - 3), indices, 1);
+    return _mm256_srli_epi32(bytes, 24);
+}
+
+// 8 pixeles por iteración con gathers, como escalarFilaBilinealFijaAVX2T.
+// Las coordenadas Q32.32 de los 8 pixeles avanzan en dos vectores de 4
+// enteros de 64 bits; la parte entera da los vecinos y la fracción los
+// pesos de cada lane. Los índices de 32 bits son relativos al menor pixel
+// fuente del bloque; si no caben (pasos o filas enormes), o el bloque
+// empieza en los 3 primeros bytes de la imagen, se usa la versión escalar.
+// Produce los mismos bytes que ella.
+template <int CANALES>
+__attribute__((target("avx2")))
+static void rotarFilaBilinealFijaAVX2T(const unsigned char* fuente, size_t paso, unsigned char* destino,
+                                       int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX,
+                                       int64_t pasoY) {
+    constexpr int canales = CANALES;
+    const int desplazamiento = BITS_COORDENADA - BITS_PESO;
+    int x = xInicio;
+
+    // Pixeles fuente que abarca un bloque en cada eje, vecino incluido
+    const int64_t alcanceX = ((7 * std::abs(pasoX)) >> BITS_COORDENADA) + 2;
+    const int64_t alcanceY = ((7 * std::abs(pasoY)) >> BITS_COORDENADA) + 2;
+    const bool indicesCaben = paso <= static_cast<size_t>(INT32_MAX) &&
+                              alcanceY * static_cast<int64_t>(paso) + alcanceX * canales <= INT32_MAX;
+
+    if (indicesCaben) {
+        const __m256i vPesoUno = _mm256_set1_epi32(PESO_UNO);
+        const __m256i vRedondeo = _mm256_set1_epi32(1 << (2 * BITS_PESO - 1));
+        const __m256i vFraccion = _mm256_set1_epi64x(0xFFFFFFFF);
+        const __m256i vRedondeoFraccion = _mm256_set1_epi64x(int64_t(1) << (desplazamiento - 1));
+        const __m256i vPaso = _mm256_set1_epi32(static_cast<int>(paso));
+        const __m256i vCanales = _mm256_set1_epi32(canales);
+        const __m256i vAvanceX = _mm256_set1_epi64x(8 * pasoX);
+        const __m256i vAvanceY = _mm256_set1_epi64x(8 * pasoY);
+
+        // Coordenadas de los pixeles x..x+3 (bajos) y x+4..x+7 (altos)
+        __m256i xBajos = _mm256_add_epi64(_mm256_set1_epi64x(origX),
+                                          _mm256_setr_epi64x(0, pasoX, 2 * pasoX, 3 * pasoX));
+        __m256i yBajos = _mm256_add_epi64(_mm256_set1_epi64x(origY),
+                                          _mm256_setr_epi64x(0, pasoY, 2 * pasoY, 3 * pasoY));
+        __m256i xAltos = _mm256_add_epi64(xBajos, _mm256_set1_epi64x(4 * pasoX));
+        __m256i yAltos = _mm256_add_epi64(yBajos, _mm256_set1_epi64x(4 * pasoY));
+
+        __m256i valores[4];
+
+        for (; x + 8 <= xFin; x += 8) {
+            // La coordenada es lineal: el menor vecino está en el primer o
+            // el último pixel del bloque
+            const int64_t ultimoX = origX + 7 * pasoX;
+            const int64_t ultimoY = origY + 7 * pasoY;
+            const int xMenor = static_cast<int>(std::min(origX, ultimoX) >> BITS_COORDENADA);
+            const int yMenor = static_cast<int>(std::min(origY, ultimoY) >> BITS_COORDENADA);
+            const size_t esquina = static_cast<size_t>(yMenor) * paso + static_cast<size_t>(xMenor) * canales;
+
+            if (esquina < 3) {
+                rotarFilaBilinealFijaT<CANALES>(fuente, paso, canales, destino, x, x + 8, origX, origY, pasoX,
+                                                pasoY);
+            } else {
+                const unsigned char* fila1 = fuente + esquina;
+                const unsigned char* fila2 = fila1 + paso;
+
+                __m256i x1 = _mm256_sub_epi32(reunirDwords<true>(xBajos, xAltos), _mm256_set1_epi32(xMenor));
+                __m256i y1 = _mm256_sub_epi32(reunirDwords<true>(yBajos, yAltos), _mm256_set1_epi32(yMenor));
+                __m256i indices = _mm256_add_epi32(_mm256_mullo_epi32(y1, vPaso), _mm256_mullo_epi32(x1, vCanales));
+
+                // Fracción Q32 -> peso Q7 redondeado, en 64 bits como la versión escalar
+                __m256i wx = reunirDwords<false>(
+                    _mm256_srli_epi64(_mm256_add_epi64(_mm256_and_si256(xBajos, vFraccion), vRedondeoFraccion),
+                                      desplazamiento),
+                    _mm256_srli_epi64(_mm256_add_epi64(_mm256_and_si256(xAltos, vFraccion), vRedondeoFraccion),
+                                      desplazamiento));
+                __m256i wy = reunirDwords<false>(
+                    _mm256_srli_epi64(_mm256_add_epi64(_mm256_and_si256(yBajos, vFraccion), vRedondeoFraccion),
+                                      desplazamiento),
+                    _mm256_srli_epi64(_mm256_add_epi64(_mm256_and_si256(yAltos, vFraccion), vRedondeoFraccion),
+                                      desplazamiento));
+                __m256i pesosX8 = _mm256_or_si256(_mm256_sub_epi32(vPesoUno, wx), _mm256_slli_epi32(wx, 16));
+                __m256i pesosY8 = _mm256_or_si256(_mm256_sub_epi32(vPesoUno, wy), _mm256_slli_epi32(wy, 16));
+
+                for (int c = 0; c < canales; c++) {
+                    __m256i i1 = _mm256_add_epi32(indices, _mm256_set1_epi32(c));
+                    __m256i i2 = _mm256_add_epi32(i1, vCanales);
+
+                    __m256i arriba = mezclarPares(cargarCanalHaciaAtras(fila1, i1),
+                                                  cargarCanalHaciaAtras(fila1, i2), pesosX8);
+                    __m256i abajo = mezclarPares(cargarCanalHaciaAtras(fila2, i1),
+                                                 cargarCanalHaciaAtras(fila2, i2), pesosX8);
+                    __m256i valor = mezclarPares(arriba, abajo, pesosY8);
+
+                    valores[c] = _mm256_srli_epi32(_mm256_add_epi32(valor, vRedondeo), 2 * BITS_PESO);
+                }
+
+                intercalarCanales<CANALES>(destino + x * canales, valores, canales);
+            }
+
+            origX += 8 * pasoX;
+            origY += 8 * pasoY;
+            xBajos = _mm256_add_epi64(xBajos, vAvanceX);
+            xAltos = _mm256_add_epi64(xAltos, vAvanceX);
+            yBajos = _mm256_add_epi64(yBajos, vAvanceY);
+            yAltos = _mm256_add_epi64(yAltos, vAvanceY);
+        }
+    }
+
+    rotarFilaBilinealFijaT<CANALES>(fuente, paso, canales, destino, x, xFin, origX, origY, pasoX, pasoY);
+}
+
+// --- Rotaciones exactas ---
+
+// Transpone 4x4 pixeles de 32 bits: columnas[i][j] = filas[j][i].
+static inline void transponer4x4(__m128i filas[4]) {
+    __m128i t0 = _mm_unpacklo_epi32(filas[0], filas[1]);
+    __m128i t1 = _mm_unpacklo_epi32(filas[2], filas[3]);
+    __m128i t2 = _mm_unpackhi_epi32(filas[0], filas[1]);
+    __m128i t3 = _mm_unpackhi_epi32(filas[2], filas[3]);
+    filas[0] = _mm_unpacklo_epi64(t0, t1);
+    filas[1] = _mm_unpackhi_epi64(t0, t1);
+    filas[2] = _mm_unpacklo_epi64(t2, t3);
+    filas[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+// Pixel fuente de la salida (nx, ny) en un giro de 'cuartos' cuartos de vuelta.
+static inline const unsigned char* pixelGirado(const unsigned char* fuente, size_t pasoFuente, int anchoFuente,
+                                               int altoFuente, int canales, int cuartos, int nx, int ny) {
+    int sx = (cuartos == 1) ? ny : anchoFuente - 1 - ny;
+    int sy = (cuartos == 1) ? altoFuente - 1 - nx : nx;
+    return fuente + static_cast<size_t>(sy) * pasoFuente + static_cast<size_t>(sx) * canales;
+}
+
+template <int CANALES>
+static void girarBloqueT(const unsigned char* fuente, size_t pasoFuente, int anchoFuente, int altoFuente,
+                         unsigned char* destino, size_t pasoDestino, int canalesDinamicos, int cuartos,
+                         int nyDesde, int nyHasta, int nxDesde, int nxHasta) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    int nyVector = nyDesde;
+    int nxVector = nxDesde;
+    if constexpr (CANALES == 4) {
+        // Cuadrados de 4x4 completos: la salida (nx + j, ny + i) sale de
+        // la fila fuente de j y la columna fuente de i, así que se cargan
+        // 4 filas fuente de 4 pixeles y se transponen
+        const int nyFin = nyDesde + (nyHasta - nyDesde) / 4 * 4;
+        const int nxFin = nxDesde + (nxHasta - nxDesde) / 4 * 4;
+        for (int ny = nyDesde; ny < nyFin; ny += 4) {
+            for (int nx = nxDesde; nx < nxFin; nx += 4) {
+                __m128i bloque[4];
+                for (int j = 0; j < 4; j++) {
+                    // Giro de 90°: columnas ny..ny+3; de 270°: las mismas, al revés
+                    const unsigned char* origen = (cuartos == 1)
+                        ? pixelGirado(fuente, pasoFuente, anchoFuente, altoFuente, 4, 1, nx + j, ny)
+                        : pixelGirado(fuente, pasoFuente, anchoFuente, altoFuente, 4, 3, nx + j, ny + 3);
+                    bloque[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(origen));
+                }
+                transponer4x4(bloque);
+                for (int i = 0; i < 4; i++) {
+                    __m128i fila = (cuartos == 1) ? bloque[i] : bloque[3 - i];
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(destino + static_cast<size_t>(ny + i) * pasoDestino +
+                                                                 static_cast<size_t>(nx) * 4), fila);
+                }
+            }
+        }
+        nyVector = nyFin;
+        nxVector = nxFin;
+    }
+
+    // Lo que no forma cuadrados de 4x4 (o todo, con otros canales): pixel a pixel
+    for (int ny = nyDesde; ny < nyHasta; ny++) {
+        unsigned char* filaDestino = destino + static_cast<size_t>(ny) * pasoDestino;
+        int nxInicio = (ny < nyVector) ? nxVector : nxDesde;
+        for (int nx = nxInicio; nx < nxHasta; nx++) {
+            const unsigned char* origen =
+                pixelGirado(fuente, pasoFuente, anchoFuente, altoFuente, canales, cuartos, nx, ny);
+            for (int c = 0; c < canales; c++) {
+                filaDestino[nx * canales + c] = origen[c];
+            }
+        }
+    }
+}
+
+void girarBloque(const unsigned char* fuente, size_t pasoFuente, int anchoFuente, int altoFuente,
+                 unsigned char* destino, size_t pasoDestino, int canales, int cuartos,
+                 int nyDesde, int nyHasta, int nxDesde, int nxHasta) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        girarBloqueT<decltype(canalesFijos)::value>(fuente, pasoFuente, anchoFuente, altoFuente, destino,
+                                                    pasoDestino, canales, cuartos, nyDesde, nyHasta, nxDesde, nxHasta);
+    });
+}
+
+template <int CANALES>
+static void invertirFilaT(const unsigned char* fuente, unsigned char* destino, int ancho, int canalesDinamicos) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    int x = 0;
+    if constexpr (CANALES == 4) {
+        // 4 pixeles por iteración, desde el final de la fuente
+        for (; x + 4 <= ancho; x += 4) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fuente + (ancho - x - 4) * 4));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destino + x * 4), _mm_shuffle_epi32(v, 0x1B));
+        }
+    }
+    for (; x < ancho; x++) {
+        const unsigned char* origen = fuente + (ancho - 1 - x) * canales;
+        for (int c = 0; c < canales; c++) {
+            destino[x * canales + c] = origen[c];
+        }
+    }
+}
+
+void invertirFila(const unsigned char* fuente, unsigned char* destino, int ancho, int canales) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        invertirFilaT<decltype(canalesFijos)::value>(fuente, destino, ancho, canales);
+    });
+}
+
+// --- Operaciones puntuales ---
+
+void aplicarTabla(unsigned char* datos, size_t n, const unsigned char* tabla) {
+    // Una búsqueda por byte: sin gather de bytes en SSE/AVX2, la tabla de
+    // 256 entradas en L1 es lo más rápido
+    for (size_t i = 0; i < n; i++) {
+        datos[i] = tabla[datos[i]];
+    }
+}
+
+// --- Remuestreo separable ---
+
+// Redondea y satura un valor filtrado a 8 bits (los lóbulos negativos de
+// bicúbico y Lanczos pueden salirse de [0, 255]).
+static inline unsigned char saturar(float valor) {
+    if (valor <= 0.0f) return 0;
+    if (valor >= 255.0f) return 255;
+    return static_cast<unsigned char>(valor + 0.5f);
+}
+
+template <int CANALES>
+__attribute__((always_inline))
+static inline void remuestrearFilaHorizontalT(const unsigned char* fuente, unsigned char* destino, int nuevoAncho,
+                                              int canalesDinamicos, const int32_t* inicio, const float* pesos,
+                                              int taps) {
+    const int canales = numeroCanales<CANALES>(canalesDinamicos);
+    for (int x = 0; x < nuevoAncho; x++) {
+        const unsigned char* muestras = fuente + inicio[x] * canales;
+        const float* w = pesos + static_cast<size_t>(x) * taps;
+        for (int c = 0; c < canales; c++) {
+            float suma = 0.0f;
+            for (int k = 0; k < taps; k++) {
+                suma += muestras[k * canales + c] * w[k];
+            }
+            destino[x * canales + c] = saturar(suma);
+        }
+    }
+}
+
+// Recorre la fila una vez por tap, acumulando en 'acumulador': el bucle
+// interno es contiguo y se vectoriza (omp simd: -O2 no lo haría solo).
+__attribute__((always_inline))
+static inline void remuestrearFilaVerticalT(const unsigned char* const* filas, const float* pesos, int taps,
+                                            unsigned char* destino, int bytesFila, float* acumulador) {
+    std::fill(acumulador, acumulador + bytesFila, 0.0f);
+    for (int k = 0; k < taps; k++) {
+        const unsigned char* fila = filas[k];
+        const float w = pesos[k];
+        if (w == 0.0f) continue;
+        #pragma omp simd
+        for (int i = 0; i < bytesFila; i++) {
+            acumulador[i] += fila[i] * w;
+        }
+    }
+    #pragma omp simd
+    for (int i = 0; i < bytesFila; i++) {
+        destino[i] = saturar(acumulador[i]);
+    }
+}
+
+// --- Reducción por caja de razón entera ---
+
+// acumulador[i] (+)= fila[i], 16 bytes por iteración con SSE2 (siempre
+// disponible en x86-64).
+static void acumularFila(uint16_t* acumulador, const unsigned char* fila, int bytes, bool primera) {
+    const __m128i cero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fila + i));
+        __m128i bajo = _mm_unpacklo_epi8(v, cero);
+        __m128i alto = _mm_unpackhi_epi8(v, cero);
+        __m128i* acc = reinterpret_cast<__m128i*>(acumulador + i);
+        if (!primera) {
+            bajo = _mm_add_epi16(bajo, _mm_loadu_si128(acc));
+            alto = _mm_add_epi16(alto, _mm_loadu_si128(acc + 1));
+        }
+        _mm_storeu_si128(acc, bajo);
+        _mm_storeu_si128(acc + 1, alto);
+    }
+    for (; i < bytes; i++) {
+        acumulador[i] = static_cast<uint16_t>((primera ? 0 : acumulador[i]) + fila[i]);
+    }
+}
+
+void reducirFilaCaja(const unsigned char* fuente, size_t paso, int razon, unsigned char* destino,
+                     int nuevoAncho, int canales, uint16_t* acumulador) {
+    // Sólo se leen las columnas que caen en algún bloque completo
+    const int bytes = nuevoAncho * razon * canales;
+    for (int k = 0; k < razon; k++) {
+        acumularFila(acumulador, fuente + k * paso, bytes, k == 0);
+    }
+
+    // (suma + d/2) / d con d = razón², como multiplicación por el inverso:
+    // exacta porque la suma redondeada es menor que 2^17
+    const uint32_t divisor = static_cast<uint32_t>(razon * razon);
+    const uint64_t inverso = ((uint64_t(1) << 32) + divisor - 1) / divisor;
+    const uint32_t mitad = divisor / 2;
+
+    despacharCanales(canales, [&](auto canalesFijos) {
+        const int canalesBloque = numeroCanales<decltype(canalesFijos)::value>(canales);
+        const int bytesBloque = razon * canalesBloque;
+        for (int x = 0; x < nuevoAncho; x++) {
+            const uint16_t* bloque = acumulador + x * bytesBloque;
+            for (int c = 0; c < canalesBloque; c++) {
+                uint32_t suma = mitad;
+                for (int k = c; k < bytesBloque; k += canalesBloque) {
+                    suma += bloque[k];
+                }
+                destino[x * canalesBloque + c] = static_cast<unsigned char>((suma * inverso) >> 32);
+            }
+        }
+    });
+}
+
+// --- Selección del nivel de instrucciones ---
+//
+// Los cuerpos genéricos (plantillas always_inline de arriba) se compilan
+// una vez por nivel insertándolos en una función con el atributo target
+// del nivel: el compilador los vectoriza y planifica para ese conjunto de
+// instrucciones. Ningún nivel activa FMA, así que el orden de las
+// operaciones en coma flotante, y por tanto el resultado, no cambia.
+
+struct CuerpoEscalarFila {
+    template <int CANALES, typename... Args>
+    static inline __attribute__((always_inline)) void llamar(Args... args) {
+        escalarFilaBilinealEscalarT<CANALES>(args...);
+    }
+};
+
+struct CuerpoEscalarFilaFija {
+    template <int CANALES, typename... Args>
+    static inline __attribute__((always_inline)) void llamar(Args... args) {
+        escalarFilaBilinealFijaEscalarT<CANALES>(args...);
+    }
+};
+
+struct CuerpoRotarFila {
+    template <int CANALES, typename... Args>
+    static inline __attribute__((always_inline)) void llamar(Args... args) {
+        rotarFilaBilinealT<CANALES>(args...);
+    }
+};
+
+struct CuerpoRotarFilaFija {
+    template <int CANALES, typename... Args>
+    static inline __attribute__((always_inline)) void llamar(Args... args) {
+        rotarFilaBilinealFijaT<CANALES>(args...);
+    }
+};
+
+struct CuerpoRemuestreoHorizontal {
+    template <int CANALES, typename... Args>
+    static inline __attribute__((always_inline)) void llamar(Args... args) {
+        remuestrearFilaHorizontalT<CANALES>(args...);
+    }
+};
+
+struct CuerpoRemuestreoVertical {
+    template <int CANALES, typename... Args>
+    static inline __attribute__((always_inline)) void llamar(Args... args) {
+        remuestrearFilaVerticalT(args...);
+    }
+};
+
+template <typename Cuerpo, int CANALES, typename... Args>
+__attribute__((target("sse4.1")))
+static void compiladoSSE41(Args... args) {
+    Cuerpo::template llamar<CANALES>(args...);
+}
+
+template <typename Cuerpo, int CANALES, typename... Args>
+__attribute__((target("avx2")))
+static void compiladoAVX2(Args... args) {
+    Cuerpo::template llamar<CANALES>(args...);
+}
+
+template <typename Cuerpo, int CANALES, typename... Args>
+__attribute__((target("avx512f,avx512bw")))
+static void compiladoAVX512(Args... args) {
+    Cuerpo::template llamar<CANALES>(args...);
+}
+
+// Ejecuta el cuerpo compilado para NIVEL.
+template <NivelSimd NIVEL, typename Cuerpo, int CANALES, typename... Args>
+static inline void enNivel(Args... args) {
+    if constexpr (NIVEL == NivelSimd::AVX512) {
+        compiladoAVX512<Cuerpo, CANALES>(args...);
+    } else if constexpr (NIVEL == NivelSimd::AVX2) {
+        compiladoAVX2<Cuerpo, CANALES>(args...);
+    } else if constexpr (NIVEL == NivelSimd::SSE41) {
+        compiladoSSE41<Cuerpo, CANALES>(args...);
+    } else {
+        Cuerpo::template llamar<CANALES>(args...);
+    }
+}
+
+// Escalado bilineal: AVX-512 y AVX2 tienen núcleos propios (gathers); lo
+// que dejan al final de la fila, y los niveles inferiores, usan el cuerpo
+// escalar compilado para el nivel.
+template <NivelSimd NIVEL>
+static void escalarFilaNivel(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                             int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, float dy) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        constexpr int CANALES = decltype(canalesFijos)::value;
+        int x = 0;
+        if constexpr (CANALES != 0 && NIVEL == NivelSimd::AVX512) {
+            x = escalarFilaBilinealAVX512T<CANALES>(fila1, fila2, destino, bytesFila, tabla, nuevoAncho, dy);
+        }
+        if constexpr (CANALES != 0 && NIVEL >= NivelSimd::AVX2) {
+            x = escalarFilaBilinealAVX2T<CANALES>(fila1, fila2, destino, bytesFila, tabla, x, nuevoAncho,
+                                                  canales, dy);
+        }
+        enNivel<NIVEL, CuerpoEscalarFila, CANALES>(fila1, fila2, destino, tabla, x, nuevoAncho, canales, dy);
+    });
+}
+
+template <NivelSimd NIVEL>
+static void escalarFilaFijaNivel(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                                 int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales,
+                                 int pesoY) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        constexpr int CANALES = decltype(canalesFijos)::value;
+        int x = 0;
+        if constexpr (CANALES != 0 && NIVEL == NivelSimd::AVX512) {
+            x = escalarFilaBilinealFijaAVX512T<CANALES>(fila1, fila2, destino, bytesFila, tabla, nuevoAncho, pesoY);
+        }
+        if constexpr (CANALES != 0 && NIVEL >= NivelSimd::AVX2) {
+            x = escalarFilaBilinealFijaAVX2T<CANALES>(fila1, fila2, destino, bytesFila, tabla, x, nuevoAncho,
+                                                      canales, pesoY);
+        }
+        enNivel<NIVEL, CuerpoEscalarFilaFija, CANALES>(fila1, fila2, destino, tabla, x, nuevoAncho, canales, pesoY);
+    });
+}
+
+template <NivelSimd NIVEL>
+static void rotarFilaNivel(const unsigned char* fuente, size_t paso, int canales, unsigned char* destino,
+                           int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX, int64_t pasoY) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        enNivel<NIVEL, CuerpoRotarFila, decltype(canalesFijos)::value>(fuente, paso, canales, destino, xInicio,
+                                                                       xFin, origX, origY, pasoX, pasoY);
+    });
+}
+
+template <NivelSimd NIVEL>
+static void rotarFilaFijaNivel(const unsigned char* fuente, size_t paso, int canales, unsigned char* destino,
+                               int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX, int64_t pasoY) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        constexpr int CANALES = decltype(canalesFijos)::value;
+        if constexpr (CANALES != 0 && NIVEL >= NivelSimd::AVX2) {
+            rotarFilaBilinealFijaAVX2T<CANALES>(fuente, paso, destino, xInicio, xFin, origX, origY, pasoX, pasoY);
+        } else {
+            enNivel<NIVEL, CuerpoRotarFilaFija, CANALES>(fuente, paso, canales, destino, xInicio, xFin, origX, origY,
+                                                         pasoX, pasoY);
+        }
+    });
+}
+
+template <NivelSimd NIVEL>
+static void remuestrearHorizontalNivel(const unsigned char* fuente, unsigned char* destino, int nuevoAncho,
+                                       int canales, const int32_t* inicio, const float* pesos, int taps) {
+    despacharCanales(canales, [&](auto canalesFijos) {
+        enNivel<NIVEL, CuerpoRemuestreoHorizontal, decltype(canalesFijos)::value>(fuente, destino, nuevoAncho,
+                                                                                  canales, inicio, pesos, taps);
+    });
+}
+
+template <NivelSimd NIVEL>
+static void remuestrearVerticalNivel(const unsigned char* const* filas, const float* pesos, int taps,
+                                     unsigned char* destino, int bytesFila, float* acumulador) {
+    enNivel<NIVEL, CuerpoRemuestreoVertical, 0>(filas, pesos, taps, destino, bytesFila, acumulador);
+}
+
+// Punteros a la implementación elegida de cada núcleo.
+struct Nucleos {
+    NivelSimd nivel;
+    decltype(&escalarFilaNivel<NivelSimd::Escalar>) escalarFila;
+    decltype(&escalarFilaFijaNivel<NivelSimd::Escalar>) escalarFilaFija;
+    decltype(&rotarFilaNivel<NivelSimd::Escalar>) rotarFila;
+    decltype(&rotarFilaFijaNivel<NivelSimd::Escalar>) rotarFilaFija;
+    decltype(&remuestrearHorizontalNivel<NivelSimd::Escalar>) remuestrearHorizontal;
+    decltype(&remuestrearVerticalNivel<NivelSimd::Escalar>) remuestrearVertical;
+};
+
+template <NivelSimd NIVEL>
+static Nucleos nucleosDeNivel() {
+    return {NIVEL, &escalarFilaNivel<NIVEL>, &escalarFilaFijaNivel<NIVEL>, &rotarFilaNivel<NIVEL>,
+            &rotarFilaFijaNivel<NIVEL>, &remuestrearHorizontalNivel<NIVEL>, &remuestrearVerticalNivel<NIVEL>};
+}
+
+// Mejor nivel que soporta la CPU.
+static NivelSimd nivelSoportado() {
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return NivelSimd::AVX512;
+    if (__builtin_cpu_supports("avx2")) return NivelSimd::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return NivelSimd::SSE41;
+    return NivelSimd::Escalar;
+}
+
+static Nucleos elegirNucleos() {
+    NivelSimd nivel = nivelSoportado();
+
+    // IPS_SIMD fuerza un nivel inferior (para probar cada uno)
+    const char* pedido = std::getenv("IPS_SIMD");
+    if (pedido && *pedido) {
+        bool valido = false;
+        for (NivelSimd candidato : {NivelSimd::Escalar, NivelSimd::SSE41, NivelSimd::AVX2, NivelSimd::AVX512}) {
+            if (std::string(pedido) != nombreNivelSimd(candidato)) continue;
+            valido = true;
+            if (candidato > nivel) {
+                std::cerr << "Aviso: la CPU no soporta IPS_SIMD=" << pedido << "; se usa "
+                          << nombreNivelSimd(nivel) << "." << std::endl;
+            } else {
+                nivel = candidato;
+            }
+        }
+        if (!valido) {
+            std::cerr << "Aviso: IPS_SIMD=" << pedido << " no es válido (escalar, sse41, avx2, avx512); se usa "
+                      << nombreNivelSimd(nivel) << "." << std::endl;
+        }
+    }
+
+    switch (nivel) {
+        case NivelSimd::AVX512: return nucleosDeNivel<NivelSimd::AVX512>();
+        case NivelSimd::AVX2:   return nucleosDeNivel<NivelSimd::AVX2>();
+        case NivelSimd::SSE41:  return nucleosDeNivel<NivelSimd::SSE41>();
+        case NivelSimd::Escalar: break;
+    }
+    return nucleosDeNivel<NivelSimd::Escalar>();
+}
+
+// Se elige una vez, en el primer uso (inicialización de estática local,
+// segura entre hilos).
+static const Nucleos& nucleos() {
+    static const Nucleos elegidos = elegirNucleos();
+    return elegidos;
+}
+
+NivelSimd nivelSimd() {
+    return nucleos().nivel;
+}
+
+const char* nombreNivelSimd(NivelSimd nivel) {
+    switch (nivel) {
+        case NivelSimd::Escalar: return "escalar";
+        case NivelSimd::SSE41:   return "sse41";
+        case NivelSimd::AVX2:    return "avx2";
+        case NivelSimd::AVX512:  return "avx512";
+    }
+    return "?";
+}
+
+void escalarFilaBilineal(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                         int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, float dy) {
+    nucleos().escalarFila(fila1, fila2, destino, bytesFila, tabla, nuevoAncho, canales, dy);
+}
+
+void escalarFilaBilinealFija(const unsigned char* fila1, const unsigned char* fila2, unsigned char* destino,
+                             int bytesFila, const TablaHorizontal& tabla, int nuevoAncho, int canales, int pesoY) {
+    nucleos().escalarFilaFija(fila1, fila2, destino, bytesFila, tabla, nuevoAncho, canales, pesoY);
+}
+
+void rotarFilaBilineal(const unsigned char* fuente, size_t paso, int canales, unsigned char* destino,
+                       int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX, int64_t pasoY) {
+    nucleos().rotarFila(fuente, paso, canales, destino, xInicio, xFin, origX, origY, pasoX, pasoY);
+}
+
+void rotarFilaBilinealFija(const unsigned char* fuente, size_t paso, int canales, unsigned char* destino,
+                           int xInicio, int xFin, int64_t origX, int64_t origY, int64_t pasoX, int64_t pasoY) {
+    nucleos().rotarFilaFija(fuente, paso, canales, destino, xInicio, xFin, origX, origY, pasoX, pasoY);
+}
+
+void remuestrearFilaHorizontal(const unsigned char* fuente, unsigned char* destino, int nuevoAncho, int canales,
+                               const int32_t* inicio, const float* pesos, int taps) {
+    nucleos().remuestrearHorizontal(fuente, destino, nuevoAncho, canales, inicio, pesos, taps);
+}
+
+void remuestrearFilaVertical(const unsigned char* const* filas, const float* pesos, int taps,
+                             unsigned char* destino, int bytesFila, float* acumulador) {
+    nucleos().remuestrearVertical(filas, pesos, taps, destino, bytesFila, acumulador);
+}
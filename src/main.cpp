@@ -1,23 +1,308 @@
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <algorithm>
 #include <cstring>
 #include <filesystem>
+#include <vector>
 #include "imagen.h"
+#include "kernels.h"
 #include "buddy_allocator.h"
+#include "stb_image.h"
 
 using namespace std;
 using namespace std::chrono;
 namespace fs = std::filesystem;
 
+// Una operación de la cadena pedida por línea de comandos.
+struct Operacion {
+    string tipo;        // "escalar", "redimensionar", "rotar", "invertir" o "piramide"
+    double parametro = 0;  // Factor de escala (horizontal) o ángulo en grados
+    double parametroY = 0;                            // Sólo para "escalar": factor vertical
+    Filtro filtro = Filtro::Bilineal;                 // Sólo para "escalar" y "redimensionar"
+    int anchoObjetivo = 0;                            // Sólo para "redimensionar": tamaño pedido
+    int altoObjetivo = 0;
+    Imagen::Ajuste ajuste = Imagen::Ajuste::Estirar;  // Sólo para "redimensionar"
+    vector<int> niveles;                              // Sólo para "piramide": niveles a guardar (1 = 1/2, ...)
+};
+
+// Holgura de la arena para asignaciones pequeñas (cachés de hilo, pmr...).
+static const size_t HOLGURA_ARENA = 1024 * 1024;
+
 void mostrarUso(const char* nombrePrograma) {
-    cout << "Uso: " << nombrePrograma << " <imagen_entrada> <imagen_salida> <operacion> [<parametros>] <-buddy | -no-buddy>" << endl;
+    cout << "Uso: " << nombrePrograma << " <imagen_entrada> <imagen_salida> <operacion> [<parametros>] [<operacion> [<parametros>] ...] [<opciones>] <modo_memoria>" << endl;
     cout << "Operaciones disponibles:" << endl;
-    cout << "  escalar <factor>      - Escala la imagen por el factor especificado (ej: 2.0 para duplicar)" << endl;
+    cout << "  escalar <factor> [<filtro>]" << endl;
+    cout << "                        - Escala la imagen por el factor especificado (ej: 2.0 para duplicar)" << endl;
+    cout << "                          Filtros: caja, bilineal (por defecto), bicubico, lanczos" << endl;
+    cout << "  escalar <fx>,<fy> [<filtro>]" << endl;
+    cout << "                        - Escala con un factor horizontal y otro vertical (ej: 1.5,0.75)" << endl;
+    cout << "  redimensionar <ancho>x<alto> [<ajuste>] [<filtro>]" << endl;
+    cout << "                        - Escala a un tamaño exacto en pixeles. Ajustes:" << endl;
+    cout << "                          estirar (por defecto): exactamente <ancho>x<alto>, un factor por eje" << endl;
+    cout << "                          ajustar: cabe entera conservando la proporción" << endl;
+    cout << "                          llenar: cubre <ancho>x<alto> conservando la proporción y recorta el centro" << endl;
     cout << "  rotar <angulo>        - Rota la imagen en su centro por el ángulo especificado en grados" << endl;
+    cout << "  invertir              - Negativo de la imagen (255 - valor en cada canal)" << endl;
+    cout << "  piramide <niveles>    - Guarda <niveles> reducciones sucesivas a la mitad en <salida>_<ancho>x<alto>.png" << endl;
+    cout << "  piramide <f1,f2,...>  - Igual, sólo los factores pedidos (0.5, 0.25, 0.125, ...)" << endl;
+    cout << "Las operaciones se aplican en el orden indicado, en un plan diferido: la geometría" << endl;
+    cout << "consecutiva se remuestrea una sola vez y 'invertir' se funde con el remuestreo anterior." << endl;
+    cout << "Opciones:" << endl;
+    cout << "  -punto-fijo           - Interpolación con pesos enteros (más rápida; idéntica con cualquier número de hilos)" << endl;
+    cout << "Variables de entorno:" << endl;
+    cout << "  IPS_SIMD=<nivel>      - Fuerza los núcleos de un nivel inferior: escalar, sse41, avx2 o avx512" << endl;
+    cout << "                          (por defecto el mejor que soporta la CPU; todos dan el mismo resultado)" << endl;
+    cout << "Modos de memoria:" << endl;
+    cout << "  -buddy                - Buddy System sobre malloc (compara también con new/delete)" << endl;
+    cout << "  -buddy-mmap           - Buddy System sobre mmap: páginas bajo demanda, devueltas al SO al liberar" << endl;
+    cout << "  -buddy-hugepages      - Como -buddy-mmap, con páginas enormes para los bloques grandes" << endl;
+    cout << "  -no-buddy             - Sólo new/delete" << endl;
     cout << "Ejemplos:" << endl;
-    cout << "  " << nombrePrograma << " entrada.jpg salida_invertida.png invertir -buddy" << endl;
     cout << "  " << nombrePrograma << " entrada.jpg salida_2x.png escalar 2.0 -buddy" << endl;
     cout << "  " << nombrePrograma << " entrada.jpg salida_rotada.png rotar 45 -no-buddy" << endl;
+    cout << "  " << nombrePrograma << " entrada.jpg salida.png escalar 0.5 rotar 30 -buddy" << endl;
+    cout << "  " << nombrePrograma << " entrada.jpg salida.png escalar 0.25 lanczos -buddy" << endl;
+    cout << "  " << nombrePrograma << " entrada.jpg salida.png redimensionar 1920x1080 llenar bicubico -buddy" << endl;
+    cout << "  " << nombrePrograma << " entrada.jpg salida.png piramide 0.5,0.25,0.125 -buddy" << endl;
+    cout << "  " << nombrePrograma << " entrada.jpg salida.png rotar 30 -punto-fijo -no-buddy" << endl;
+    cout << "  " << nombrePrograma << " entrada.jpg salida.png escalar 1.5 rotar 30 invertir -buddy" << endl;
+}
+
+// Factores de "escalar": uno para ambos ejes o "fx,fy".
+static bool leerFactores(const string& texto, double& factorX, double& factorY) {
+    size_t coma = texto.find(',');
+    try {
+        size_t leidos;
+        factorX = stod(texto.substr(0, coma), &leidos);
+        if (leidos != texto.substr(0, coma).size()) return false;
+        factorY = factorX;
+        if (coma != string::npos) {
+            factorY = stod(texto.substr(coma + 1), &leidos);
+            if (leidos != texto.size() - coma - 1) return false;
+        }
+    } catch (const exception& e) {
+        return false;
+    }
+    return factorX > 0 && factorY > 0;
+}
+
+// Tamaño de "redimensionar": "<ancho>x<alto>", ambos positivos.
+static bool leerTamano(const string& texto, int& ancho, int& alto) {
+    size_t equis = texto.find('x');
+    if (equis == string::npos) return false;
+    try {
+        size_t leidos;
+        ancho = stoi(texto.substr(0, equis), &leidos);
+        if (leidos != equis) return false;
+        alto = stoi(texto.substr(equis + 1), &leidos);
+        if (leidos != texto.size() - equis - 1) return false;
+    } catch (const exception& e) {
+        return false;
+    }
+    return ancho > 0 && alto > 0;
+}
+
+// Niveles de "piramide": un número N (niveles 1..N) o una lista de
+// factores 1/2^k separados por comas (niveles k).
+static bool leerNivelesPiramide(const string& texto, vector<int>& niveles) {
+    if (texto.find_first_of(".,") == string::npos) {
+        int cuantos;
+        try {
+            cuantos = stoi(texto);
+        } catch (const exception& e) {
+            return false;
+        }
+        if (cuantos < 1 || cuantos > 30) return false;
+        for (int k = 1; k <= cuantos; k++) niveles.push_back(k);
+        return true;
+    }
+
+    size_t desde = 0;
+    while (desde <= texto.size()) {
+        size_t coma = texto.find(',', desde);
+        if (coma == string::npos) coma = texto.size();
+        double factor;
+        try {
+            factor = stod(texto.substr(desde, coma - desde));
+        } catch (const exception& e) {
+            return false;
+        }
+        if (factor <= 0 || factor >= 1) return false;
+        int nivel = static_cast<int>(lround(-log2(factor)));
+        if (nivel < 1 || nivel > 30 || fabs(ldexp(factor, nivel) - 1.0) > 1e-6) return false;
+        niveles.push_back(nivel);
+        desde = coma + 1;
+    }
+    return true;
+}
+
+// Opciones globales que pueden aparecer entre las operaciones.
+struct Opciones {
+    Imagen::Precision precision = Imagen::Precision::Flotante;
+};
+
+// Interpreta argv[3 .. argc-2] como una cadena de operaciones y opciones.
+bool leerOperaciones(int argc, char* argv[], vector<Operacion>& operaciones, Opciones& opciones) {
+    for (int i = 3; i < argc - 1; ) {
+        if (string(argv[i]) == "-punto-fijo") {
+            opciones.precision = Imagen::Precision::PuntoFijo;
+            i++;
+            continue;
+        }
+
+        Operacion op;
+        op.tipo = argv[i];
+        if (op.tipo != "escalar" && op.tipo != "redimensionar" && op.tipo != "rotar" && op.tipo != "invertir" &&
+            op.tipo != "piramide") {
+            cerr << "Error: Operación no válida '" << op.tipo
+                 << "'. Use 'escalar', 'redimensionar', 'rotar', 'invertir' o 'piramide'." << endl;
+            return false;
+        }
+        if (op.tipo == "invertir") {
+            // Sin parámetros
+            operaciones.push_back(op);
+            i++;
+            continue;
+        }
+        if (i + 1 >= argc - 1) {
+            cerr << "Error: Número incorrecto de argumentos para " << op.tipo << "." << endl;
+            return false;
+        }
+
+        if (op.tipo == "escalar") {
+            if (!leerFactores(argv[i + 1], op.parametro, op.parametroY)) {
+                cerr << "Error: Factor de escala inválido '" << argv[i + 1]
+                     << "'. Use un factor mayor que 0 o dos separados por una coma (fx,fy)." << endl;
+                return false;
+            }
+            // Filtro opcional tras el factor
+            if (i + 2 < argc - 1 && filtroDesdeNombre(argv[i + 2], op.filtro)) {
+                i++;
+            }
+        } else if (op.tipo == "redimensionar") {
+            if (!leerTamano(argv[i + 1], op.anchoObjetivo, op.altoObjetivo)) {
+                cerr << "Error: Tamaño inválido '" << argv[i + 1] << "'. Use <ancho>x<alto> (ej: 1920x1080)." << endl;
+                return false;
+            }
+            // Ajuste y filtro opcionales, en ese orden
+            if (i + 2 < argc - 1 && Imagen::ajusteDesdeNombre(argv[i + 2], op.ajuste)) {
+                i++;
+            }
+            if (i + 2 < argc - 1 && filtroDesdeNombre(argv[i + 2], op.filtro)) {
+                i++;
+            }
+        } else if (op.tipo == "piramide") {
+            if (!leerNivelesPiramide(argv[i + 1], op.niveles)) {
+                cerr << "Error: Niveles de pirámide inválidos '" << argv[i + 1]
+                     << "'. Use un número de niveles o factores 1/2^k separados por comas." << endl;
+                return false;
+            }
+            op.parametro = 0;
+        } else {
+            try {
+                op.parametro = stod(argv[i + 1]);
+            } catch (const exception& e) {
+                cerr << "Error: Ángulo inválido." << endl;
+                return false;
+            }
+        }
+        operaciones.push_back(op);
+        i += 2;
+    }
+    return !operaciones.empty();
+}
+
+// Bloque buddy (potencia de dos, mínimo 64 bytes) que ocupa un buffer.
+static size_t bloqueBuddy(size_t bytes) {
+    size_t bloque = 64;
+    while (bloque < bytes) bloque <<= 1;
+    return bloque;
+}
+
+// Tamaño de arena necesario para la cadena de operaciones, a partir de la
+// cabecera de la imagen. La imagen cargada vive fuera de la arena (buffer de
+// stbi adoptado); cada operación reserva su salida en la arena mientras la
+// entrada sigue viva, y después libera la entrada.
+size_t calcularTamanoArena(int ancho, int alto, int canales, const vector<Operacion>& operaciones) {
+    size_t pico = 0;
+    size_t entradaEnArena = 0;
+
+    for (const Operacion& op : operaciones) {
+        int nuevoAncho, nuevoAlto;
+        // La inversión se funde con el paso anterior o se hace en el sitio
+        if (op.tipo == "invertir") continue;
+        if (op.tipo == "piramide") {
+            // Todos los niveles viven a la vez; la imagen no cambia
+            int profundidad = *max_element(op.niveles.begin(), op.niveles.end());
+            size_t niveles = 0;
+            for (int k = 1, w = ancho / 2, h = alto / 2; k <= profundidad; k++, w /= 2, h /= 2) {
+                niveles += bloqueBuddy(Imagen::bytesPixeles(w, h, canales));
+            }
+            pico = max(pico, entradaEnArena + niveles);
+            continue;
+        }
+        Imagen::Escalado escalado;
+        const bool escala = (op.tipo == "escalar" || op.tipo == "redimensionar");
+        if (op.tipo == "escalar") {
+            escalado = Imagen::escaladoPorFactores(ancho, alto, static_cast<float>(op.parametro),
+                                                   static_cast<float>(op.parametroY));
+        } else if (op.tipo == "redimensionar") {
+            escalado = Imagen::escaladoPorTamano(ancho, alto, op.anchoObjetivo, op.altoObjetivo, op.ajuste);
+        }
+        if (escala) {
+            nuevoAncho = escalado.nuevoAncho;
+            nuevoAlto = escalado.nuevoAlto;
+        } else {
+            Imagen::dimensionesRotacion(ancho, alto, op.parametro, nuevoAncho, nuevoAlto);
+        }
+        size_t salida = bloqueBuddy(Imagen::bytesPixeles(nuevoAncho, nuevoAlto, canales));
+        // El remuestreo separable tiene además viva una imagen intermedia
+        // (a lo sumo nuevoAncho x alto) mientras escribe la salida
+        size_t intermedia = 0;
+        if (escala && Imagen::escaladoSeparable(escalado, op.filtro)) {
+            intermedia = bloqueBuddy(Imagen::bytesPixeles(nuevoAncho, alto, canales));
+        }
+        pico = max(pico, entradaEnArena + salida + intermedia);
+
+        entradaEnArena = salida;
+        ancho = nuevoAncho;
+        alto = nuevoAlto;
+    }
+    return pico + HOLGURA_ARENA;
+}
+
+// Anota la cadena de operaciones en el plan diferido de la imagen y lo
+// ejecuta: la imagen compone la geometría consecutiva y funde las
+// operaciones puntuales antes de tocar pixeles. Devuelve false si algún
+// paso falla; la imagen queda entonces a medio procesar.
+bool aplicarOperaciones(Imagen& imagen, const vector<Operacion>& operaciones, const Opciones& opciones,
+                        const string& rutaSalida, const string& sufijo) {
+    imagen.establecerPrecision(opciones.precision);
+    for (const Operacion& op : operaciones) {
+        if (op.tipo == "escalar") {
+            imagen.planificarEscalado(static_cast<float>(op.parametro), static_cast<float>(op.parametroY), op.filtro);
+        } else if (op.tipo == "redimensionar") {
+            imagen.planificarRedimension(op.anchoObjetivo, op.altoObjetivo, op.ajuste, op.filtro);
+        } else if (op.tipo == "rotar") {
+            imagen.planificarRotacion(op.parametro);
+        } else if (op.tipo == "invertir") {
+            imagen.planificarInversion();
+        } else if (op.tipo == "piramide") {
+            // Necesita los pixeles: ejecuta lo anotado hasta aquí
+            if (!imagen.guardarPiramide(op.niveles, rutaSalida)) {
+                cerr << "Error: No se pudo generar la pirámide" << sufijo << "; no se guarda la imagen." << endl;
+                return false;
+            }
+            cout << "[INFO] Pirámide generada correctamente" << sufijo << "." << endl;
+        }
+    }
+    if (!imagen.materializar()) {
+        cerr << "Error: No se pudieron aplicar las operaciones" << sufijo << "; no se guarda la imagen." << endl;
+        return false;
+    }
+    cout << "[INFO] Operaciones aplicadas correctamente" << sufijo << "." << endl;
+    return true;
 }
 
 int main(int argc, char* argv[]) {
@@ -29,58 +314,36 @@ int main(int argc, char* argv[]) {
 
     string rutaEntrada = argv[1];
     string rutaSalida = argv[2];
-    string operacion = argv[3];
-    string modo;
-    float factorEscala = 1.0f;
-    double angulo = 0.0;
+    string modo = argv[argc - 1];
 
     if (!fs::exists("output")) {
         fs::create_directory("output");
     }
 
-    if (operacion == "escalar") {
-        if (argc != 6) {
-            cerr << "Error: Número incorrecto de argumentos para escalar." << endl;
-            mostrarUso(argv[0]);
-            return 1;
-        }
-        try {
-            factorEscala = stof(argv[4]);
-            if (factorEscala <= 0) {
-                cerr << "Error: El factor de escala debe ser mayor que 0." << endl;
-                return 1;
-            }
-        } catch (const exception& e) {
-            cerr << "Error: Factor de escala inválido." << endl;
-            return 1;
-        }
-        modo = argv[5];
-    } else if (operacion == "rotar") {
-        if (argc != 6) {
-            cerr << "Error: Número incorrecto de argumentos para rotar." << endl;
-            mostrarUso(argv[0]);
-            return 1;
-        }
-        try {
-            angulo = stod(argv[4]);
-        } catch (const exception& e) {
-            cerr << "Error: Ángulo inválido." << endl;
-            return 1;
-        }
-        modo = argv[5];
-    } else {
-        cerr << "Error: Operación no válida. Use 'invertir', 'escalar' o 'rotar'." << endl;
+    vector<Operacion> operaciones;
+    Opciones opciones;
+    if (!leerOperaciones(argc, argv, operaciones, opciones)) {
         mostrarUso(argv[0]);
         return 1;
     }
 
     bool usarBuddy = false;
+    BuddyAllocator::Respaldo respaldo = BuddyAllocator::Respaldo::Malloc;
+    string descripcionRespaldo;
     if (modo == "-buddy") {
         usarBuddy = true;
+    } else if (modo == "-buddy-mmap") {
+        usarBuddy = true;
+        respaldo = BuddyAllocator::Respaldo::Mmap;
+        descripcionRespaldo = " (mmap)";
+    } else if (modo == "-buddy-hugepages") {
+        usarBuddy = true;
+        respaldo = BuddyAllocator::Respaldo::MmapHugePages;
+        descripcionRespaldo = " (mmap + páginas enormes)";
     } else if (modo == "-no-buddy") {
         usarBuddy = false;
     } else {
-        cerr << "Error: Modo inválido. Usa -buddy o -no-buddy." << endl;
+        cerr << "Error: Modo inválido. Usa -buddy, -buddy-mmap, -buddy-hugepages o -no-buddy." << endl;
         mostrarUso(argv[0]);
         return 1;
     }
@@ -91,28 +354,33 @@ int main(int argc, char* argv[]) {
         cout << "=== PROCESAMIENTO DE IMAGEN ===" << endl;
         cout << "Archivo de entrada: " << rutaEntrada << endl;
         cout << "Archivo de salida: " << rutaSalida << endl;
-        cout << "Modo de asignación de memoria: Buddy System" << endl;
+        cout << "Modo de asignación de memoria: Buddy System" << descripcionRespaldo << endl;
+        cout << "Núcleos SIMD: " << nombreNivelSimd(nivelSimd()) << endl;
         cout << "------------------------" << endl;
         cout << "[INFO] Procesamiento con Buddy System:" << endl;
 
-        BuddyAllocator allocator(512 * 1024 * 1024);
+        // Dimensionar la arena con la cabecera, sin decodificar la imagen
+        int anchoCabecera, altoCabecera, canalesCabecera;
+        if (!stbi_info(rutaEntrada.c_str(), &anchoCabecera, &altoCabecera, &canalesCabecera)) {
+            cerr << "Error al leer la cabecera de la imagen: " << rutaEntrada << endl;
+            return 1;
+        }
+        size_t tamanoArena = calcularTamanoArena(anchoCabecera, altoCabecera, canalesCabecera, operaciones);
+        cout << "[INFO] Arena del Buddy System: " << tamanoArena / 1024 << " KB" << endl;
+
+        BuddyAllocator allocator(tamanoArena, true, respaldo);
         Imagen imagenBuddy(rutaEntrada, &allocator);
         if (!imagenBuddy.cargar()) return 1;
         imagenBuddy.mostrarInformacion();
 
         auto inicioBuddy = high_resolution_clock::now();
 
-        if (operacion == "escalar") {
-            imagenBuddy.escalarImagen(factorEscala);
-            cout << "[INFO] Imagen escalada correctamente (Buddy System)." << endl;
-        } else if (operacion == "rotar") {
-            imagenBuddy.rotarImagen(angulo);
-            cout << "[INFO] Imagen rotada correctamente (Buddy System)." << endl;
-        }
+        if (!aplicarOperaciones(imagenBuddy, operaciones, opciones, rutaSalida, " (Buddy System)")) return 1;
 
         auto finBuddy = high_resolution_clock::now();
         auto duracionBuddy = duration_cast<milliseconds>(finBuddy - inicioBuddy).count();
-        imagenBuddy.guardarImagen(rutaSalida);
+        if (!imagenBuddy.guardarImagen(rutaSalida)) return 1;
+        allocator.imprimirEstadisticas(cout);
 
         cout << "------------------------" << endl;
         cout << "[INFO] Procesamiento con sistema convencional (new/delete):" << endl;
@@ -122,13 +390,7 @@ int main(int argc, char* argv[]) {
 
         auto inicioConvencional = high_resolution_clock::now();
 
-        if (operacion == "escalar") {
-            imagenConvencional.escalarImagen(factorEscala);
-            cout << "[INFO] Imagen escalada correctamente (Convencional)." << endl;
-        } else if (operacion == "rotar") {
-            imagenConvencional.rotarImagen(angulo);
-            cout << "[INFO] Imagen rotada correctamente (Convencional)." << endl;
-        }
+        if (!aplicarOperaciones(imagenConvencional, operaciones, opciones, rutaSalida, " (Convencional)")) return 1;
 
         auto finConvencional = high_resolution_clock::now();
         auto duracionConvencional = duration_cast<milliseconds>(finConvencional - inicioConvencional).count();
@@ -144,6 +406,7 @@ int main(int argc, char* argv[]) {
         cout << "Archivo de entrada: " << rutaEntrada << endl;
         cout << "Archivo de salida: " << rutaSalida << endl;
         cout << "Modo de asignación de memoria: Convencional (new/delete)" << endl;
+        cout << "Núcleos SIMD: " << nombreNivelSimd(nivelSimd()) << endl;
         cout << "------------------------" << endl;
 
         Imagen imagen(rutaEntrada);
@@ -152,16 +415,11 @@ int main(int argc, char* argv[]) {
 
         auto inicio = high_resolution_clock::now();
 
-        if (operacion == "escalar") {
-            imagen.escalarImagen(factorEscala);
-            cout << "[INFO] Imagen escalada correctamente." << endl;
-        } else if (operacion == "rotar") {
-            imagen.rotarImagen(angulo);
-            cout << "[INFO] Imagen rotada correctamente." << endl;
-        }
+        if (!aplicarOperaciones(imagen, operaciones, opciones, rutaSalida, "")) return 1;
 
         auto fin = high_resolution_clock::now();
         auto duracion = duration_cast<milliseconds>(fin - inicio).count();
+        if (!imagen.guardarImagen(rutaSalida)) return 1;
 
         cout << "------------------------" << endl;
         cout << "TIEMPO DE PROCESAMIENTO: " << duracion << " ms" << endl;
@@ -0,0 +1,147 @@
+/// Archivo: remuestreo.cpp
+/// Filtros de reconstrucción y listas de contribuciones del remuestreo separable
+
+#include "remuestreo.h"
+#include <algorithm>
+#include <cmath>
+
+// Radio del soporte de cada filtro, en muestras fuente (sin ensanchar).
+static double radioFiltro(Filtro filtro) {
+    switch (filtro) {
+        case Filtro::Caja:     return 0.5;
+        case Filtro::Bilineal: return 1.0;
+        case Filtro::Bicubico: return 2.0;
+        case Filtro::Lanczos:  return 3.0;
+    }
+    return 1.0;
+}
+
+static double sinc(double x) {
+    if (x == 0.0) return 1.0;
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+// Valor del filtro a una distancia x (en muestras) del centro.
+static double evaluarFiltro(Filtro filtro, double x) {
+    switch (filtro) {
+        case Filtro::Caja:
+            return (x >= -0.5 && x < 0.5) ? 1.0 : 0.0;
+        case Filtro::Bilineal:
+            x = std::fabs(x);
+            return x < 1.0 ? 1.0 - x : 0.0;
+        case Filtro::Bicubico: {
+            const double a = -0.5;
+            x = std::fabs(x);
+            if (x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+            if (x < 2.0) return ((a * x - 5.0 * a) * x + 8.0 * a) * x - 4.0 * a;
+            return 0.0;
+        }
+        case Filtro::Lanczos:
+            return std::fabs(x) < 3.0 ? sinc(x) * sinc(x / 3.0) : 0.0;
+    }
+    return 0.0;
+}
+
+const char* nombreFiltro(Filtro filtro) {
+    switch (filtro) {
+        case Filtro::Caja:     return "caja";
+        case Filtro::Bilineal: return "bilineal";
+        case Filtro::Bicubico: return "bicubico";
+        case Filtro::Lanczos:  return "lanczos";
+    }
+    return "?";
+}
+
+bool filtroDesdeNombre(const std::string& nombre, Filtro& filtro) {
+    for (Filtro candidato : {Filtro::Caja, Filtro::Bilineal, Filtro::Bicubico, Filtro::Lanczos}) {
+        if (nombre == nombreFiltro(candidato)) {
+            filtro = candidato;
+            return true;
+        }
+    }
+    return false;
+}
+
+// La cota de taps es holgada (el bicúbico al ampliar la da 6 con sólo 4
+// pesos no nulos): reduce 'taps' al mayor tramo de pesos no nulos y
+// compacta la tabla, para que las pasadas no multipliquen por cero.
+static void recortarContribuciones(int tamanoFuente, Contribuciones& contribuciones) {
+    const int taps = contribuciones.taps;
+    const int tamanoDestino = static_cast<int>(contribuciones.inicio.size());
+
+    int nuevosTaps = 1;
+    for (int i = 0; i < tamanoDestino; i++) {
+        const float* pesos = &contribuciones.pesos[static_cast<size_t>(i) * taps];
+        int primero = 0, ultimo = taps - 1;
+        while (primero < ultimo && pesos[primero] == 0.0f) primero++;
+        while (ultimo > primero && pesos[ultimo] == 0.0f) ultimo--;
+        nuevosTaps = std::max(nuevosTaps, ultimo - primero + 1);
+    }
+    if (nuevosTaps == taps) return;
+
+    // Compactación en el sitio: la fila i se copia hacia delante a
+    // i * nuevosTaps <= i * taps, así que nunca pisa filas sin copiar
+    for (int i = 0; i < tamanoDestino; i++) {
+        const float* pesos = &contribuciones.pesos[static_cast<size_t>(i) * taps];
+        int primero = 0;
+        while (primero < taps - 1 && pesos[primero] == 0.0f) primero++;
+        // Ventana desde el primer peso no nulo, sin salirse de la fuente
+        int inicio = std::min(contribuciones.inicio[i] + primero, tamanoFuente - nuevosTaps);
+        int desplazamiento = inicio - contribuciones.inicio[i];
+
+        std::copy(pesos + desplazamiento, pesos + desplazamiento + nuevosTaps,
+                  &contribuciones.pesos[static_cast<size_t>(i) * nuevosTaps]);
+        contribuciones.inicio[i] = inicio;
+    }
+    contribuciones.taps = nuevosTaps;
+    contribuciones.pesos.resize(static_cast<size_t>(tamanoDestino) * nuevosTaps);
+}
+
+void calcularContribuciones(int tamanoFuente, int tamanoDestino, int primeraSalida, float factor, Filtro filtro,
+                            Contribuciones& contribuciones) {
+    // Al reducir, el filtro se estira sobre la fuente: cada salida promedia
+    // todas las muestras que cubre
+    const double escala = factor < 1.0f ? 1.0 / factor : 1.0;
+    const double soporte = radioFiltro(filtro) * escala;
+
+    // Como mucho ceil(2 * soporte) + 2 muestras caen dentro del soporte
+    int taps = static_cast<int>(std::ceil(2.0 * soporte)) + 2;
+    taps = std::min(taps, tamanoFuente);
+
+    contribuciones.taps = taps;
+    contribuciones.inicio.assign(tamanoDestino, 0);
+    contribuciones.pesos.assign(static_cast<size_t>(tamanoDestino) * taps, 0.0f);
+
+    for (int i = 0; i < tamanoDestino; i++) {
+        // Centro de la salida i en coordenadas de la fuente (bordes en enteros)
+        const double centro = (primeraSalida + i + 0.5) / factor;
+        int primero = std::max(static_cast<int>(std::floor(centro - soporte)), 0);
+        int ultimo = std::min(static_cast<int>(std::ceil(centro + soporte)) - 1, tamanoFuente - 1);
+        int inicio = std::min(primero, tamanoFuente - taps);
+        float* pesos = &contribuciones.pesos[static_cast<size_t>(i) * taps];
+
+        // Las muestras fuera de la imagen se descartan y el resto se
+        // renormaliza
+        double suma = 0.0;
+        for (int k = primero; k <= ultimo; k++) {
+            double peso = evaluarFiltro(filtro, (k + 0.5 - centro) / escala);
+            pesos[k - inicio] = static_cast<float>(peso);
+            suma += peso;
+        }
+
+        if (suma != 0.0) {
+            for (int k = 0; k < taps; k++) {
+                pesos[k] = static_cast<float>(pesos[k] / suma);
+            }
+        } else {
+            // Soporte vacío (sólo posible en los bordes): vecino más cercano
+            int cercano = std::clamp(static_cast<int>(centro), 0, tamanoFuente - 1);
+            inicio = std::min(cercano, tamanoFuente - taps);
+            pesos[cercano - inicio] = 1.0f;
+        }
+        contribuciones.inicio[i] = inicio;
+    }
+
+    recortarContribuciones(tamanoFuente, contribuciones);
+}
@@ -0,0 +1,133 @@
+/// Archivo: test_plan.cpp
+/// Compara las cadenas geométricas compuestas por el plan diferido con las
+/// mismas operaciones aplicadas una a una, incluidos los pixeles del borde.
+
+#include "imagen.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Operación de una cadena: escalar (parametro = factor) o rotar (grados).
+struct Operacion {
+    bool rotar;
+    double parametro;
+};
+
+static const string IMAGEN_PRUEBA = "test/testImg/test.png";
+
+// Diferencia media admitida entre la cadena compuesta (un remuestreo) y la
+// aplicada paso a paso (uno por operación), en todo y en cada borde.
+static const double MEDIA_MAXIMA = 1.0;
+static const double MEDIA_MAXIMA_BORDE = 4.0;
+
+struct Pixeles {
+    int ancho = 0, alto = 0, canales = 0;
+    vector<unsigned char> datos;
+};
+
+static bool leer(const string& ruta, Pixeles& imagen) {
+    unsigned char* datos = stbi_load(ruta.c_str(), &imagen.ancho, &imagen.alto, &imagen.canales, 0);
+    if (!datos) return false;
+    imagen.datos.assign(datos, datos + static_cast<size_t>(imagen.ancho) * imagen.alto * imagen.canales);
+    stbi_image_free(datos);
+    return true;
+}
+
+// Aplica la cadena, compuesta (plan diferido) o una operación tras otra, y
+// guarda el resultado en 'ruta'.
+static bool aplicar(const vector<Operacion>& cadena, bool compuesta, const string& ruta) {
+    Imagen imagen(IMAGEN_PRUEBA);
+    if (!imagen.cargar()) return false;
+    for (const Operacion& op : cadena) {
+        bool correcto = true;
+        if (compuesta) {
+            if (op.rotar) {
+                imagen.planificarRotacion(op.parametro);
+            } else {
+                imagen.planificarEscalado(static_cast<float>(op.parametro));
+            }
+        } else if (op.rotar) {
+            correcto = imagen.rotarImagen(op.parametro);
+        } else {
+            correcto = imagen.escalarImagen(static_cast<float>(op.parametro));
+        }
+        if (!correcto) return false;
+    }
+    return imagen.guardarImagen(ruta);
+}
+
+// Diferencia absoluta media de los pixeles de [x0, x1) x [y0, y1).
+static double diferenciaMedia(const Pixeles& a, const Pixeles& b, int x0, int x1, int y0, int y1) {
+    double suma = 0;
+    size_t muestras = 0;
+    for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+            for (int c = 0; c < a.canales; c++) {
+                size_t i = (static_cast<size_t>(y) * a.ancho + x) * a.canales + c;
+                suma += std::abs(a.datos[i] - b.datos[i]);
+                muestras++;
+            }
+        }
+    }
+    return muestras ? suma / muestras : 0.0;
+}
+
+static bool probar(const string& nombre, const vector<Operacion>& cadena) {
+    const string rutaCompuesta = "output/prueba_plan_compuesta.png";
+    const string rutaPasos = "output/prueba_plan_pasos.png";
+    Pixeles compuesta, pasos;
+    if (!aplicar(cadena, true, rutaCompuesta) || !aplicar(cadena, false, rutaPasos) ||
+        !leer(rutaCompuesta, compuesta) || !leer(rutaPasos, pasos)) {
+        cerr << "[FALLO] " << nombre << ": no se pudo aplicar la cadena" << endl;
+        return false;
+    }
+    if (compuesta.ancho != pasos.ancho || compuesta.alto != pasos.alto || compuesta.canales != pasos.canales) {
+        cerr << "[FALLO] " << nombre << ": dimensiones " << compuesta.ancho << "x" << compuesta.alto << " frente a "
+             << pasos.ancho << "x" << pasos.alto << endl;
+        return false;
+    }
+
+    const int w = compuesta.ancho, h = compuesta.alto;
+    const double total = diferenciaMedia(compuesta, pasos, 0, w, 0, h);
+    const double bordes[4] = {
+        diferenciaMedia(compuesta, pasos, 0, 1, 0, h),        // izquierdo
+        diferenciaMedia(compuesta, pasos, w - 1, w, 0, h),    // derecho
+        diferenciaMedia(compuesta, pasos, 0, w, 0, 1),        // superior
+        diferenciaMedia(compuesta, pasos, 0, w, h - 1, h),    // inferior
+    };
+    double peorBorde = 0;
+    for (double borde : bordes) peorBorde = std::max(peorBorde, borde);
+
+    bool correcto = total <= MEDIA_MAXIMA && peorBorde <= MEDIA_MAXIMA_BORDE;
+    (correcto ? cout : cerr) << (correcto ? "[OK] " : "[FALLO] ") << nombre << ": diferencia media " << total
+                             << ", peor borde " << peorBorde << endl;
+    return correcto;
+}
+
+int main() {
+    struct Caso {
+        string nombre;
+        vector<Operacion> cadena;
+    };
+    const vector<Caso> casos = {
+        {"escalar 1.5 escalar 1.2", {{false, 1.5}, {false, 1.2}}},
+        {"escalar 1.5 rotar 30", {{false, 1.5}, {true, 30}}},
+        {"rotar 30 escalar 1.5", {{true, 30}, {false, 1.5}}},
+        {"rotar 20 rotar 25", {{true, 20}, {true, 25}}},
+        {"escalar 1.3 rotar 20 escalar 1.4 rotar -35", {{false, 1.3}, {true, 20}, {false, 1.4}, {true, -35}}},
+    };
+
+    int fallos = 0;
+    for (const Caso& caso : casos) {
+        if (!probar(caso.nombre, caso.cadena)) fallos++;
+    }
+    cout << (fallos ? "[FALLO] " : "[OK] ") << casos.size() - fallos << "/" << casos.size()
+         << " cadenas compuestas coinciden con sus pasos" << endl;
+    return fallos ? EXIT_FAILURE : EXIT_SUCCESS;
+}